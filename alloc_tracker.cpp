@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "alloc_tracker.h"
+
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* ptr);
+}
+
+static void count_allocation(void* ptr);
+static void count_free(void* ptr);
+
+//============================================================================================================
+
+thread_local bool alloc_tracking_enabled __attribute__((tls_model("initial-exec"))) = false;
+
+static std::atomic<uint64_t> allocations;
+static std::atomic<uint64_t> frees;
+static std::atomic<uint64_t> bytes_allocated;
+static std::atomic<uint64_t> bytes_freed;
+static std::atomic<int64_t> live_bytes;
+static std::atomic<int64_t> peak_live_bytes;
+
+//============================================================================================================
+
+bool alloc_tracking_available() {
+    return true;
+}
+
+void alloc_tracking_reset() {
+    allocations = 0;
+    frees = 0;
+    bytes_allocated = 0;
+    bytes_freed = 0;
+    live_bytes = 0;
+    peak_live_bytes = 0;
+}
+
+void alloc_tracking_stats(alloc_stats_t* stats) {
+    assert(stats);
+
+    stats->allocations = allocations;
+    stats->frees = frees;
+    stats->bytes_allocated = bytes_allocated;
+    stats->bytes_freed = bytes_freed;
+    stats->peak_live_bytes = peak_live_bytes;
+}
+
+//============================================================================================================
+
+// Sizes are taken from malloc_usable_size() on both sides, so that a free matches its allocation
+// whatever size was asked for. Memory freed while tracking but allocated before it counts as well,
+// which is why live bytes may go below zero.
+static void count_allocation(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    int64_t size = (int64_t) malloc_usable_size(ptr);
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes_allocated.fetch_add((uint64_t) size, std::memory_order_relaxed);
+
+    int64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+static void count_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    int64_t size = (int64_t) malloc_usable_size(ptr);
+
+    frees.fetch_add(1, std::memory_order_relaxed);
+    bytes_freed.fetch_add((uint64_t) size, std::memory_order_relaxed);
+    live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+//============================================================================================================
+
+// malloc, calloc, realloc, reallocarray, free, memalign, aligned_alloc, posix_memalign, valloc and pvalloc
+// are replaced; the last ones go through memalign or realloc, so every block the free override sees was
+// counted when it was allocated. operator new reaches malloc through libstdc++.
+extern "C" {
+
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+
+    if (alloc_tracking_enabled) {
+        count_allocation(ptr);
+    }
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+
+    if (alloc_tracking_enabled) {
+        count_allocation(ptr);
+    }
+    return ptr;
+}
+
+// Counted as a free of the old block and an allocation of the new one.
+void* realloc(void* ptr, size_t size) {
+    if (alloc_tracking_enabled) {
+        count_free(ptr);
+    }
+
+    void* new_ptr = __libc_realloc(ptr, size);
+
+    if (alloc_tracking_enabled) {
+        count_allocation(new_ptr ? new_ptr : (size ? ptr : nullptr));
+    }
+    return new_ptr;
+}
+
+void* reallocarray(void* ptr, size_t count, size_t size) {
+    size_t total = 0;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return realloc(ptr, total);
+}
+
+void free(void* ptr) {
+    if (alloc_tracking_enabled) {
+        count_free(ptr);
+    }
+
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    void* ptr = __libc_memalign(alignment, size);
+
+    if (alloc_tracking_enabled) {
+        count_allocation(ptr);
+    }
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+void* valloc(size_t size) {
+    return memalign((size_t) sysconf(_SC_PAGESIZE), size);
+}
+
+// Rounds the size up to whole pages, a size of 0 gets one page.
+void* pvalloc(size_t size) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t pages = size ? size / page + (size % page != 0) : 1;
+
+    if (pages > SIZE_MAX / page) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return memalign(page, pages * page);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+
+    void* new_ptr = memalign(alignment, size);
+    if (!new_ptr) {
+        return ENOMEM;
+    }
+
+    *ptr = new_ptr;
+    return 0;
+}
+
+} /* extern "C" */
+
+#else
+
+//============================================================================================================
+
+bool alloc_tracking_available() {
+    return false;
+}
+
+void alloc_tracking_reset() {}
+
+void alloc_tracking_stats(alloc_stats_t* stats) {
+    assert(stats);
+
+    memset(stats, 0, sizeof(alloc_stats_t));
+}
+
+#endif /* BENCHMARK_TRACK_ALLOCATIONS */
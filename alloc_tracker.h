@@ -0,0 +1,43 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Built with -DBENCHMARK_TRACK_ALLOCATIONS, alloc_tracker.cpp replaces malloc, calloc, realloc, free and
+// the aligned allocators of the program and counts the calls made by threads inside
+// alloc_tracking_begin() / alloc_tracking_end(). Without it tracking is unavailable and costs nothing.
+
+typedef struct {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    uint64_t bytes_freed;
+    int64_t peak_live_bytes;   // highest bytes_allocated - bytes_freed since the last reset
+} alloc_stats_t;
+
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+
+extern thread_local bool alloc_tracking_enabled __attribute__((tls_model("initial-exec")));
+
+inline void alloc_tracking_begin() {
+    alloc_tracking_enabled = true;
+}
+
+inline void alloc_tracking_end() {
+    alloc_tracking_enabled = false;
+}
+
+#else
+
+inline void alloc_tracking_begin() {}
+
+inline void alloc_tracking_end() {}
+
+#endif /* BENCHMARK_TRACK_ALLOCATIONS */
+
+bool alloc_tracking_available();
+void alloc_tracking_reset();
+void alloc_tracking_stats(alloc_stats_t* stats);
+
+#endif /* ALLOC_TRACKER_H */
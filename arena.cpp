@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+#include "logger.h"
+
+//============================================================================================================
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+//============================================================================================================
+
+bool arena_ctor(arena_t* arena, size_t size, bool huge_pages) {
+    assert(arena);
+    assert(size != 0);
+
+    size_t page_size = huge_pages ? HUGE_PAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+    size = (size + page_size - 1) & ~(page_size - 1);
+
+    // Over-allocated by one huge page, so that the arena can start on a huge page boundary.
+    size_t mapped_size = huge_pages ? size + HUGE_PAGE_SIZE : size;
+
+    void* mapping = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR, "Can't map an arena of %zu bytes: %s\n", mapped_size, strerror(errno));
+        memset(arena, 0, sizeof(arena_t));
+        return false;
+    }
+
+    char* base = (char*) mapping;
+
+    if (huge_pages) {
+        char* aligned = (char*) (((uintptr_t) base + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+        size_t head = (size_t) (aligned - base);
+
+        if (head) {
+            munmap(base, head);
+        }
+        if (HUGE_PAGE_SIZE - head) {
+            munmap(aligned + size, HUGE_PAGE_SIZE - head);
+        }
+        base = aligned;
+
+        if (madvise(base, size, MADV_HUGEPAGE)) {
+            static bool warned = false;
+
+            if (!warned) {
+                LOG(WARNING, "Huge pages are unavailable, the arena uses regular pages: %s\n", strerror(errno));
+                warned = true;
+            }
+            huge_pages = false;
+        }
+    }
+
+    arena->base = base;
+    arena->size = size;
+    arena->used = 0;
+    arena->huge_pages = huge_pages;
+    return true;
+}
+
+void arena_dtor(arena_t* arena) {
+    assert(arena);
+
+    if (arena->base) {
+        munmap(arena->base, arena->size);
+    }
+
+    memset(arena, 0, sizeof(arena_t));
+}
+
+void arena_prefault(arena_t* arena) {
+    assert(arena);
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    for (size_t offset = 0; offset < arena->size; offset += page_size) {
+        ((volatile char*) arena->base)[offset] = 0;
+    }
+}
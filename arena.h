@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Bump allocator over one anonymous mapping. Blocks are never freed one by one, the whole arena is reset
+// or unmapped at once. With huge pages the mapping is rounded up to 2 MiB and advised with MADV_HUGEPAGE,
+// which transparent huge pages honour in the "madvise" and "always" modes.
+
+typedef struct {
+    char* base;
+    size_t size;
+    size_t used;
+    bool huge_pages;
+} arena_t;
+
+bool arena_ctor(arena_t* arena, size_t size, bool huge_pages);
+void arena_dtor(arena_t* arena);
+
+// Writes to every page, so that later use of the arena takes no page faults.
+void arena_prefault(arena_t* arena);
+
+inline void arena_reset(arena_t* arena) {
+    arena->used = 0;
+}
+
+// Returns nullptr when the arena is exhausted. alignment must be a power of two.
+inline void* arena_alloc(arena_t* arena, size_t size, size_t alignment) {
+    size_t offset = (arena->used + alignment - 1) & ~(alignment - 1);
+
+    if (!arena->base || offset > arena->size || size > arena->size - offset) {
+        return nullptr;
+    }
+
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+#endif /* ARENA_H */
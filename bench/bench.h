@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "benchmark.h"
+
+// Shared by the benchmarks of self_bench: long enough to settle the library's own small kernels, short
+// enough to keep a full run of the suite quick.
+const double BENCH_MIN_WARMUP_TIME = 0.1;   // s
+const double BENCH_MAX_TESTING_TIME = 1;    // s
+
+inline void bench_defaults(benchmark_t*) {
+    set_min_warmup_time(BENCH_MIN_WARMUP_TIME);
+    set_max_testing_time(BENCH_MAX_TESTING_TIME);
+}
+
+// The defaults for kernels that process one item per iteration.
+inline void bench_defaults_items(benchmark_t* bm) {
+    bench_defaults(bm);
+    set_items_per_iteration(1);
+}
+
+#endif /* BENCH_H */
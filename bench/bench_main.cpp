@@ -0,0 +1,4 @@
+#include "benchmark.h"
+
+// The benchmarks of the other files in this directory register themselves statically.
+BENCHMARK_MAIN()
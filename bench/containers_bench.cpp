@@ -0,0 +1,118 @@
+#include <stdint.h>
+
+#include "bench.h"
+#include "queue.h"
+#include "vector.h"
+
+// vector_t and circ_buffer_t cost per element, with the SPSC ring next to the circular buffer it replaced
+// in the harness.
+
+const size_t ERASE_VECTOR_SIZE = 4096;
+const size_t RING_CAPACITY = 1024;
+
+static void vector_push_back_bench(context_t* ctx) {
+    vector_t* vec = new_vector(sizeof(int64_t));
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        int64_t value = (int64_t) i;
+        vector_push_back(vec, &value);
+    }
+    DoNotOptimize(*(char*) vec->data);
+
+    vector_delete(vec);
+}
+
+static void fill_vector(context_t* ctx) {
+    vector_t* vec = new_vector(sizeof(int64_t));
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        int64_t value = (int64_t) i;
+        vector_push_back(vec, &value);
+    }
+
+    ctx->data = vec;
+}
+
+static void delete_vector(context_t* ctx) {
+    vector_delete((vector_t*) ctx->data);
+    ctx->data = nullptr;
+}
+
+static void vector_pop_back_bench(context_t* ctx) {
+    vector_t* vec = (vector_t*) ctx->data;
+    int64_t value = 0;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        vector_pop_back(vec, &value);
+        DoNotOptimize(value);
+    }
+}
+
+// Every iteration erases args[0] elements from the front of a 4096 element vector and appends them back.
+static void vector_erase_elms_bench(context_t* ctx) {
+    static vector_t* vec = nullptr;
+    size_t width = (size_t) ctx->args[0];
+
+    if (!vec) {
+        vec = new_vector(sizeof(int64_t));
+        for (size_t i = 0; i < ERASE_VECTOR_SIZE; i++) {
+            int64_t value = (int64_t) i;
+            vector_push_back(vec, &value);
+        }
+    }
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        vector_erase_elms(vec, 0, width);
+
+        for (size_t j = 0; j < width; j++) {
+            int64_t value = (int64_t) j;
+            vector_push_back(vec, &value);
+        }
+    }
+    DoNotOptimize(*(char*) vec->data);
+}
+
+static void cb_push_pop_bench(context_t* ctx) {
+    static circ_buffer_t buffer = {};
+    if (!buffer.buffer_holder) {
+        cb_ctor(&buffer, RING_CAPACITY, sizeof(double));
+    }
+
+    double value = 0;
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        cb_push(&buffer, &value);
+        cb_pop(&buffer, &value);
+    }
+    DoNotOptimize(value);
+}
+
+static void spsc_push_pop_bench(context_t* ctx) {
+    static spsc_ring_t ring = {};
+    if (!ring.data) {
+        spsc_ring_ctor(&ring, RING_CAPACITY, sizeof(double));
+    }
+
+    double value = 0;
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        spsc_ring_push(&ring, &value);
+        spsc_ring_pop(&ring, &value);
+    }
+    DoNotOptimize(value);
+}
+
+static void configure_pop(benchmark_t* bm) {
+    bench_defaults_items(bm);
+    set_fixture(fill_vector, delete_vector);
+}
+
+static void configure_erase(benchmark_t* bm) {
+    bench_defaults_items(bm);
+    benchmark_arg(16);
+    benchmark_arg(256);
+}
+
+BENCHMARK_APPLY(vector_push_back_bench, bench_defaults_items);
+BENCHMARK_APPLY(vector_pop_back_bench, configure_pop);
+BENCHMARK_APPLY(vector_erase_elms_bench, configure_erase);
+BENCHMARK_APPLY(cb_push_pop_bench, bench_defaults_items);
+BENCHMARK_APPLY(spsc_push_pop_bench, bench_defaults_items);
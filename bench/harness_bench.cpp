@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "histogram.h"
+#include "queue.h"
+#include "stats.h"
+#include "timer.h"
+
+// What run_testing() does around every timed sample: the timer pair, recording the sample in the buffer
+// and the histogram, and sliding the epsilon window by one deviation.
+
+const size_t SAMPLES_CAPACITY = 1 << 20;
+const size_t WINDOW_SIZE = 100;
+
+static void timer_pair(context_t* ctx) {
+    ticks_t total = 0;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        ticks_t start = timer_start();
+        ticks_t end = timer_stop();
+        total += end - start;
+    }
+    DoNotOptimize(total);
+}
+
+static void record_sample(context_t* ctx) {
+    static samples_t samples = {};
+    static histogram_t histogram = {};
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        if (samples.size == samples.capacity) {
+            samples_ctor(&samples, SAMPLES_CAPACITY);
+        }
+
+        double sample = 100.0 + (double) (i & 63);
+        samples_push(&samples, sample);
+        histogram_record(&histogram, sample);
+    }
+    DoNotOptimize(histogram.total);
+}
+
+static void slide_window(context_t* ctx) {
+    static spsc_ring_t window = {};
+    double average = 0;
+
+    if (!window.data) {
+        spsc_ring_ctor(&window, WINDOW_SIZE, sizeof(double));
+        for (size_t i = 0; i < WINDOW_SIZE; i++) {
+            spsc_ring_push(&window, &average);
+        }
+    }
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        double deviation = 0.01 * (double) (i & 7);
+        double popped = 0;
+
+        spsc_ring_pop(&window, &popped);
+        spsc_ring_push(&window, &deviation);
+        average += (deviation - popped) / (double) WINDOW_SIZE;
+    }
+    DoNotOptimize(average);
+}
+
+BENCHMARK_APPLY(timer_pair, bench_defaults);
+BENCHMARK_APPLY(record_sample, bench_defaults);
+BENCHMARK_APPLY(slide_window, bench_defaults);
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "logger.h"
+
+// Log() throughput with the output going to /dev/null, synchronously, through the background writer and
+// as deferred binary records, into a flight recorder alone, and the cost of a message below the minimum
+// level.
+
+static FILE* null_file() {
+    static FILE* file = fopen("/dev/null", "w");
+    return file;
+}
+
+static void log_to_null(context_t*) {
+    LoggerSetFile(null_file());
+    LoggerSetLevel(DEBUG);
+}
+
+static void log_to_stderr(context_t*) {
+    LoggerSetFile(stderr);
+    LoggerSetLevel(DEBUG);
+}
+
+static void log_to_null_async(context_t* ctx) {
+    log_to_null(ctx);
+    LoggerStartAsync(LOG_DEFAULT_QUEUE_CAPACITY, LOG_OVERFLOW_BLOCK);
+}
+
+static void log_to_stderr_sync(context_t* ctx) {
+    LoggerStopAsync();
+    log_to_stderr(ctx);
+}
+
+static void log_to_null_binary(context_t* ctx) {
+    log_to_null(ctx);
+    LoggerSetBinaryFile(null_file());
+}
+
+static void log_to_stderr_text(context_t* ctx) {
+    LoggerFlush();
+    LoggerSetBinaryFile(nullptr);
+    log_to_stderr(ctx);
+}
+
+static void log_to_recorder(context_t*) {
+    LoggerSetFile(nullptr);
+    LoggerSetFlightRecorder("/tmp/logger_bench.flight", 1 << 20);
+}
+
+static void log_to_stderr_unrecorded(context_t* ctx) {
+    LoggerSetFlightRecorder(nullptr, 0);
+    unlink("/tmp/logger_bench.flight");
+    log_to_stderr(ctx);
+}
+
+static void log_written(context_t* ctx) {
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        LOG(INFO, "sample %zu took %f ns\n", i, 42.0);
+    }
+}
+
+static void log_written_async(context_t* ctx) {
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        LOG(INFO, "sample %zu took %f ns\n", i, 42.0);
+    }
+}
+
+static void log_written_binary(context_t* ctx) {
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        LOG_BINARY(INFO, "sample %zu took %f ns\n", i, 42.0);
+    }
+}
+
+static void log_written_recorder(context_t* ctx) {
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        LOG(INFO, "sample %zu took %f ns\n", i, 42.0);
+    }
+}
+
+static void log_filtered(context_t* ctx) {
+    LoggerSetLevel(ERROR);
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        LOG(INFO, "sample %zu took %f ns\n", i, 42.0);
+    }
+
+    LoggerSetLevel(DEBUG);
+}
+
+static void configure(benchmark_t* bm) {
+    bench_defaults_items(bm);
+    set_fixture(log_to_null, log_to_stderr);
+}
+
+static void configure_async(benchmark_t* bm) {
+    configure(bm);
+    set_fixture(log_to_null_async, log_to_stderr_sync);
+}
+
+static void configure_binary(benchmark_t* bm) {
+    configure(bm);
+    set_fixture(log_to_null_binary, log_to_stderr_text);
+}
+
+static void configure_recorder(benchmark_t* bm) {
+    configure(bm);
+    set_fixture(log_to_recorder, log_to_stderr_unrecorded);
+}
+
+BENCHMARK_APPLY(log_written, configure);
+BENCHMARK_APPLY(log_written_async, configure_async);
+BENCHMARK_APPLY(log_written_binary, configure_binary);
+BENCHMARK_APPLY(log_written_recorder, configure_recorder);
+BENCHMARK_APPLY(log_filtered, configure);
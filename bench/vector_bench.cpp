@@ -0,0 +1,72 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "typed_vector.h"
+
+// Per-push cost of vector<T> against std::vector<T>. Every sample fills a fresh vector with
+// ctx->iterations elements, so the growth reallocations are amortized into the reported time.
+
+static void typed_push_double(context_t* ctx) {
+    vector<double> values;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.push_back((double) i);
+    }
+    DoNotOptimize(values.data);
+}
+
+static void std_push_double(context_t* ctx) {
+    std::vector<double> values;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.push_back((double) i);
+    }
+    DoNotOptimize(*values.data());
+}
+
+static void typed_push_double_reserved(context_t* ctx) {
+    vector<double> values;
+    values.reserve(ctx->iterations);
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.push_back((double) i);
+    }
+    DoNotOptimize(values.data);
+}
+
+static void std_push_double_reserved(context_t* ctx) {
+    std::vector<double> values;
+    values.reserve(ctx->iterations);
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.push_back((double) i);
+    }
+    DoNotOptimize(*values.data());
+}
+
+// Not trivially copyable: growth moves the elements one by one.
+static void typed_emplace_string(context_t* ctx) {
+    vector<std::string> values;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.emplace_back("a string longer than the small buffer");
+    }
+    DoNotOptimize(values.data);
+}
+
+static void std_emplace_string(context_t* ctx) {
+    std::vector<std::string> values;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        values.emplace_back("a string longer than the small buffer");
+    }
+    DoNotOptimize(*values.data());
+}
+
+BENCHMARK_APPLY(typed_push_double, bench_defaults_items);
+BENCHMARK_APPLY(std_push_double, bench_defaults_items);
+BENCHMARK_APPLY(typed_push_double_reserved, bench_defaults_items);
+BENCHMARK_APPLY(std_push_double_reserved, bench_defaults_items);
+BENCHMARK_APPLY(typed_emplace_string, bench_defaults_items);
+BENCHMARK_APPLY(std_emplace_string, bench_defaults_items);
@@ -1,18 +1,58 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <assert.h>
 #include <math.h>
+#include <regex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "benchmark.h"
+#include "reporter.h"
+#include "regression.h"
+#include "logger.h"
 
 static void set_warmup_results(test_t* results);
 static void set_begin_results(test_t* results);
 static void set_testing_results(test_t* results);
+static void set_thread_results(test_t* results);
+static void set_allocations_results(test_t* results);
+static void set_rate_results(test_t* results);
 
 static void initialize_test_info(test_t* test, state_t state);
 
-static clock_t run_test(state_t state);
+static ticks_t run_test(state_t state, ticks_t* wall_time = nullptr);
+static ticks_t run_batch(size_t thread_index, void* arg);
+static ticks_t active_time(const context_t* ctx, ticks_t start, ticks_t end);
+static double paused_time(const context_t* ctx);
+static void record_paused(thread_batch_t* batch, const context_t* ctx);
+static void add_processed(benchmark_t* bm, const context_t* ctx);
+static void reset_processed(benchmark_t* bm);
+static thread_pool_t* thread_pool();
+static thread_batch_t* thread_batch();
+static perf_counters_t* perf_counters();
+static sample_stream_t* sample_stream();
+static arena_t* arena();
+static arena_t* measurement_arena();
+static void prepare_arena();
+static void release_arena();
+static void sample_stream_start();
+static void sample_stream_stop();
+static void* sample_stream_consume(void* arg);
+static void record_sample(double sample);
+static overhead_t* overhead();
+static bool* repetition_child();
+static void calibrate_overhead();
+static double median_test_time(size_t tests_cnt);
+static double iteration_baseline();
+static double push_sample(ticks_t test_time);
+static void calibrate_iterations(test_t* warmup);
 static void run_warmup();
+static void run_steady_warmup(test_t* warmup);
 static void begin_testing();
 static void run_testing();
 
@@ -21,20 +61,170 @@ static void group_deviation_ctor();
 static void group_deviation_dtor();
 static void group_deviation_push(double* elm, state_t state);
 
+static precision_tracker_t* precision_tracker();
+static void precision_reset();
+static void precision_push(double sample);
+static bool precision_reached();
+static void precision_update();
+static bool keep_testing(const test_t* main_tests, ticks_t max_test_time);
+
+static benchmark_t* benchmark_add(const char* name);
 static bool compare_doubles(double a, double b);
+static int compare_ticks(const void* a, const void* b);
+static int compare_sizes(const void* a, const void* b);
+static int compare_sample_doubles(const void* a, const void* b);
+static const char* option_value(const char* arg, const char* option);
+static void print_usage(const char* program);
+static bool run_current();
+static bool run_once();
+static bool run_repetitions();
+static bool run_repetition(samples_t* pooled, histogram_t* histogram, repetition_message_t* message);
+static bool send_repetition(int fd);
+static bool receive_repetition(int fd, samples_t* pooled, histogram_t* histogram, repetition_message_t* message);
+static void set_repetitions_results(const repetition_message_t* last);
+static bool write_all(int fd, const void* data, size_t size);
+static bool read_all(int fd, void* data, size_t size);
+static bool run_and_report(benchmark_t* bm);
+static void add_point(const int64_t* args, size_t args_cnt);
+static size_t expand_range(const range_t* range, int64_t* values);
+static void add_range_product(const range_t* ranges, size_t ranges_cnt, int64_t* point, size_t depth);
+static void add_thread_count(size_t threads);
+static bool is_family(const benchmark_t* bm);
+static bool same_args(const benchmark_t* lhs, const benchmark_t* rhs);
+static void expand_family(benchmark_t* family);
+static void fit_family(benchmark_t* family);
+static void scale_family(benchmark_t* family);
 //============================================================================================================
 
-const clock_t MIN_WARMUP_TIME = 10000000;
-const clock_t MAX_TEST_TIME = 10000000;
+const uint64_t MIN_WARMUP_TIME = 10000000000;
+const uint64_t STEADY_MIN_WARMUP_TIME = 10000000;
+const size_t STEADY_STATE_WINDOW = 64;
+const size_t STEADY_STATE_SEGMENTS = 4;
+const double STEADY_STATE_TOLERANCE = 0.02;
+const uint64_t MAX_TEST_TIME = 10000000000;
+const uint64_t SAMPLE_TIME = 100000;
+const size_t MAX_ITERATIONS = 1000000000;
+const double ITERATIONS_GROWTH_MARGIN = 1.4;
+const double MAX_ITERATIONS_GROWTH = 10;
+const double NS_PER_SEC = 1e9;
+const char* const DEFAULT_BENCHMARK_NAME = "benchmark";
+const size_t OVERHEAD_TESTS_CNT = 1000;
+const size_t OVERHEAD_ITERATIONS = 1000;
+const size_t MAX_SAMPLES = 1 << 20;
+const double COMPARE_ALPHA = 0.05;
+const double COMPARE_THRESHOLD = 0.05;
+const int EXIT_REGRESSION = 2;
+const size_t MAX_RANGE_VALUES = 64;
 const size_t CONTROL_GROUP_SIZE = 100;
+const size_t SAMPLE_STREAM_CAPACITY = 4096;
+const long SAMPLE_STREAM_IDLE_NS = 50000;
+const size_t ARENA_SLACK = 4 * CACHE_LINE_SIZE;
 const double EPSILON = 1e-2;
+const double DEFAULT_CONFIDENCE = 0.95;
+const size_t PRECISION_MIN_SAMPLES = 10;
+const size_t PRECISION_CHECK_INTERVAL = 16;
+const size_t PRECISION_CHECK_DIVISOR = 16;
+const size_t PRECISION_MEDIAN_CHECK_DIVISOR = 4;
 const double EPSILON_DOUBLE = 1e-9;
 
 //============================================================================================================
 
+registry_t* registry() {
+    static registry_t registry = {};
+    return &registry;
+}
+
 benchmark_t* benchmark() {
-    static benchmark_t test = {};
-    return &test;
+    if (!registry()->current) {
+        benchmark_add(DEFAULT_BENCHMARK_NAME);
+    }
+
+    return registry()->current;
+}
+
+static benchmark_t* benchmark_find(const char* name) {
+    assert(name);
+
+    for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        if (!strcmp(bm->name, name)) {
+            return bm;
+        }
+    }
+
+    return nullptr;
+}
+
+static benchmark_t* benchmark_add(const char* name) {
+    assert(name);
+
+    benchmark_t* bm = benchmark_find(name);
+    if (bm) {
+        LOG(WARNING, "Benchmark \"%s\" is already registered, replacing its function\n", name);
+        bm->func = nullptr;
+        bm->context_func = nullptr;
+        registry()->current = bm;
+        return bm;
+    }
+
+    bm = (benchmark_t*) calloc(1, sizeof(benchmark_t));
+    if (!bm) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return nullptr;
+    }
+
+    bm->name = name;
+
+    if (registry()->tail) {
+        registry()->tail->next = bm;
+    }
+    else {
+        registry()->head = bm;
+    }
+
+    registry()->tail = bm;
+    registry()->current = bm;
+    registry()->size++;
+    return bm;
+}
+
+benchmark_t* benchmark_register(const char* name, test_func_t test_func) {
+    benchmark_t* bm = benchmark_add(name);
+    if (bm) {
+        bm->func = test_func;
+    }
+
+    return bm;
+}
+
+benchmark_t* benchmark_register(const char* name, context_func_t context_func) {
+    benchmark_t* bm = benchmark_add(name);
+    if (bm) {
+        bm->context_func = context_func;
+    }
+
+    return bm;
+}
+
+benchmark_t* benchmark_select(const char* name) {
+    benchmark_t* bm = benchmark_find(name);
+    if (!bm) {
+        LOG(WARNING, "Benchmark \"%s\" is not registered\n", name);
+        return nullptr;
+    }
+
+    registry()->current = bm;
+    return bm;
+}
+
+benchmark_t* benchmark_apply(benchmark_t* bm, apply_func_t apply) {
+    assert(apply);
+
+    if (bm) {
+        registry()->current = bm;
+        apply(bm);
+    }
+
+    return bm;
 }
 
 void benchmark_func(test_func_t test_func) {
@@ -42,18 +232,437 @@ void benchmark_func(test_func_t test_func) {
 }
 
 void set_min_warmup_time(double seconds) {
-    benchmark()->min_warmup_time = seconds * CLOCKS_PER_SEC;
+    benchmark()->min_warmup_time = (uint64_t) (seconds * NS_PER_SEC);
+}
+
+void set_steady_state_warmup(bool steady, double tolerance) {
+    assert(tolerance > 0);
+
+    benchmark()->warmup.steady_state = steady;
+    benchmark()->warmup.tolerance = tolerance;
+}
+
+void set_max_warmup_time(double seconds) {
+    benchmark()->warmup.max_time = (uint64_t) (seconds * NS_PER_SEC);
 }
 
 void set_epsilon(double epsilon) {
     benchmark()->epsilon = epsilon;
 }
 
+void set_target_precision(double relative, double confidence) {
+    assert(relative >= 0);
+    assert(confidence > 0 && confidence < 1);
+
+    benchmark()->precision.target = relative;
+    benchmark()->precision.confidence = confidence;
+}
+
+void set_precision_statistic(precision_statistic_t statistic) {
+    benchmark()->precision.statistic = statistic;
+}
+
+void set_sample_count_bounds(size_t min_samples, size_t max_samples) {
+    assert(max_samples == 0 || min_samples <= max_samples);
+
+    benchmark()->precision.min_samples = min_samples;
+    benchmark()->precision.max_samples = max_samples;
+}
+
 void set_max_testing_time(double seconds) {
-    benchmark()->max_test_time = seconds * CLOCKS_PER_SEC;
+    benchmark()->max_test_time = (uint64_t) (seconds * NS_PER_SEC);
+}
+
+void set_sample_time(double seconds) {
+    benchmark()->sample_time = (uint64_t) (seconds * NS_PER_SEC);
+}
+
+void set_timer(timer_backend_t backend) {
+    benchmark()->timer = backend;
+}
+
+void set_subtract_baseline(bool subtract) {
+    benchmark()->subtract_baseline = subtract;
+}
+
+void set_max_samples(size_t max_samples) {
+    benchmark()->max_samples = max_samples;
+}
+
+void set_complexity(complexity_t complexity) {
+    benchmark()->complexity = complexity;
+}
+
+void set_threads(size_t threads) {
+    assert(threads != 0);
+
+    benchmark()->threads = threads;
+}
+
+void set_check_environment(bool check) {
+    benchmark()->environment_config.enabled = check;
+}
+
+void set_pin_cpu(int cpu) {
+    benchmark()->environment_config.enabled = true;
+    benchmark()->environment_config.pin = true;
+    benchmark()->environment_config.cpu = cpu;
+}
+
+void set_raise_priority(bool raise) {
+    benchmark()->environment_config.enabled |= raise;
+    benchmark()->environment_config.raise_priority = raise;
+}
+
+void set_perf_counters(bool enable) {
+    benchmark()->perf_counters = enable;
+}
+
+void set_track_allocations(bool track) {
+    benchmark()->track_allocations = track;
+}
+
+void set_async_samples(bool async) {
+    benchmark()->async_samples = async;
+}
+
+void set_huge_pages(bool huge_pages) {
+    benchmark()->huge_pages = huge_pages;
+}
+
+void set_fixture(fixture_func_t setup, fixture_func_t teardown) {
+    benchmark()->setup = setup;
+    benchmark()->teardown = teardown;
+}
+
+void set_iteration_fixture(fixture_func_t setup, fixture_func_t teardown) {
+    benchmark()->iteration_setup = setup;
+    benchmark()->iteration_teardown = teardown;
+}
+
+void set_bytes_per_iteration(int64_t bytes) {
+    benchmark()->bytes_per_iteration = bytes;
+}
+
+void set_items_per_iteration(int64_t items) {
+    benchmark()->items_per_iteration = items;
+}
+
+void set_repetitions(size_t repetitions) {
+    benchmark()->repetitions = repetitions;
+}
+
+//============================================================================================================
+
+void benchmark_arg(int64_t arg) {
+    add_point(&arg, 1);
+}
+
+void benchmark_args(const int64_t* args, size_t args_cnt) {
+    add_point(args, args_cnt);
+}
+
+void benchmark_range(int64_t start, int64_t limit, int64_t multiplier) {
+    range_t range = {start, limit, multiplier};
+    benchmark_ranges(&range, 1);
+}
+
+void benchmark_dense_range(int64_t start, int64_t limit, int64_t step) {
+    assert(step > 0);
+
+    for (int64_t arg = start; arg <= limit; arg += step) {
+        add_point(&arg, 1);
+    }
+}
+
+void benchmark_ranges(const range_t* ranges, size_t ranges_cnt) {
+    assert(ranges);
+    assert(ranges_cnt <= BENCHMARK_MAX_ARGS);
+
+    int64_t point[BENCHMARK_MAX_ARGS] = {};
+    add_range_product(ranges, ranges_cnt, point, 0);
+}
+
+void benchmark_threads(size_t threads) {
+    add_thread_count(threads);
+}
+
+// min_threads, 2 * min_threads, 4 * min_threads, ... below max_threads, then max_threads itself.
+void benchmark_thread_range(size_t min_threads, size_t max_threads) {
+    assert(min_threads != 0);
+    assert(min_threads <= max_threads);
+
+    for (size_t threads = min_threads; threads < max_threads; threads *= 2) {
+        add_thread_count(threads);
+    }
+
+    add_thread_count(max_threads);
+}
+
+void benchmark_threads_sweep() {
+    benchmark_thread_range(1, hardware_concurrency());
+}
+
+static void add_point(const int64_t* args, size_t args_cnt) {
+    assert(args);
+    assert(args_cnt <= BENCHMARK_MAX_ARGS);
+
+    benchmark_t* bm = benchmark();
+
+    if (bm->expanded) {
+        LOG(WARNING, "Arguments of \"%s\" are added after its first run and are ignored\n", bm->name);
+        return;
+    }
+
+    arg_point_t* points = (arg_point_t*) realloc(bm->points, (bm->points_cnt + 1) * sizeof(arg_point_t));
+    if (!points) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return;
+    }
+
+    bm->points = points;
+    memcpy(bm->points[bm->points_cnt].args, args, args_cnt * sizeof(int64_t));
+    bm->points[bm->points_cnt].args_cnt = args_cnt;
+    bm->points_cnt++;
+}
+
+static void add_thread_count(size_t threads) {
+    assert(threads != 0);
+
+    benchmark_t* bm = benchmark();
+
+    if (bm->expanded) {
+        LOG(WARNING, "Thread counts of \"%s\" are added after its first run and are ignored\n", bm->name);
+        return;
+    }
+
+    size_t* thread_counts = (size_t*) realloc(bm->thread_counts, (bm->thread_counts_cnt + 1) * sizeof(size_t));
+    if (!thread_counts) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return;
+    }
+
+    bm->thread_counts = thread_counts;
+    bm->thread_counts_cnt++;
+    bm->thread_counts[bm->thread_counts_cnt - 1] = threads;
+}
+
+// start, start * multiplier, start * multiplier^2, ... below limit, then limit itself.
+static size_t expand_range(const range_t* range, int64_t* values) {
+    assert(range->multiplier >= 2);
+    assert(range->start <= range->limit);
+
+    size_t values_cnt = 0;
+    values[values_cnt++] = range->start;
+
+    int64_t value = range->start > 0 ? range->start : 1;
+    while (value <= range->limit / range->multiplier && values_cnt < MAX_RANGE_VALUES - 1) {
+        value *= range->multiplier;
+        if (value < range->limit && value > values[values_cnt - 1]) {
+            values[values_cnt++] = value;
+        }
+    }
+
+    if (range->limit != values[values_cnt - 1]) {
+        values[values_cnt++] = range->limit;
+    }
+
+    return values_cnt;
+}
+
+static void add_range_product(const range_t* ranges, size_t ranges_cnt, int64_t* point, size_t depth) {
+    if (depth == ranges_cnt) {
+        add_point(point, ranges_cnt);
+        return;
+    }
+
+    int64_t values[MAX_RANGE_VALUES] = {};
+    size_t values_cnt = expand_range(&ranges[depth], values);
+
+    for (size_t i = 0; i < values_cnt; i++) {
+        point[depth] = values[i];
+        add_range_product(ranges, ranges_cnt, point, depth + 1);
+    }
+}
+
+static bool is_family(const benchmark_t* bm) {
+    return bm->points_cnt || bm->thread_counts_cnt;
+}
+
+static bool same_args(const benchmark_t* lhs, const benchmark_t* rhs) {
+    return lhs->args_cnt == rhs->args_cnt && !memcmp(lhs->args, rhs->args, lhs->args_cnt * sizeof(int64_t));
+}
+
+// Every argument point and thread count of a family becomes its own registry entry, named
+// "family/arg0/arg1.../threads:N", placed right after the family and configured as the family
+// was at its first run. Instances of one argument point are adjacent, in increasing thread count.
+static void expand_family(benchmark_t* family) {
+    assert(family);
+
+    if (family->expanded || !is_family(family)) {
+        return;
+    }
+
+    family->expanded = true;
+    benchmark_t* previous = family;
+
+    if (family->thread_counts_cnt) {
+        qsort(family->thread_counts, family->thread_counts_cnt, sizeof(size_t), compare_sizes);
+    }
+
+    arg_point_t no_args = {};
+    size_t points_cnt = family->points_cnt ? family->points_cnt : 1;
+    size_t threads_cnt = family->thread_counts_cnt ? family->thread_counts_cnt : 1;
+
+    for (size_t i = 0; i < points_cnt * threads_cnt; i++) {
+        benchmark_t* instance = (benchmark_t*) calloc(1, sizeof(benchmark_t));
+        if (!instance) {
+            LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+            return;
+        }
+
+        // A plain copy of the configuration; the buffers the family owns are detached below.
+        memcpy((void*) instance, family, sizeof(benchmark_t));
+
+        instance->family = family;
+        instance->points = nullptr;
+        instance->points_cnt = 0;
+        instance->thread_counts = nullptr;
+        instance->thread_counts_cnt = 0;
+        instance->repetition_times = nullptr;
+        new (&instance->samples) samples_t();
+        instance->warmup_results = {};
+        instance->begin_results = {};
+        instance->testing_results = {};
+        instance->environment = {};
+        histogram_reset(&instance->histogram);
+
+        const arg_point_t* point = family->points_cnt ? &family->points[i / threads_cnt] : &no_args;
+        memcpy(instance->args, point->args, point->args_cnt * sizeof(int64_t));
+        instance->args_cnt = point->args_cnt;
+        instance->complexity_n = point->args_cnt ? point->args[0] : 0;
+
+        if (family->thread_counts_cnt) {
+            instance->threads = family->thread_counts[i % threads_cnt];
+        }
+
+        int len = snprintf(instance->instance_name, BENCHMARK_MAX_NAME_LEN, "%s", family->name);
+        for (size_t arg = 0; arg < point->args_cnt && len < BENCHMARK_MAX_NAME_LEN; arg++) {
+            len += snprintf(instance->instance_name + len, (size_t) (BENCHMARK_MAX_NAME_LEN - len),
+                            "/%lld", (long long) point->args[arg]);
+        }
+        if (family->thread_counts_cnt && len < BENCHMARK_MAX_NAME_LEN) {
+            snprintf(instance->instance_name + len, (size_t) (BENCHMARK_MAX_NAME_LEN - len),
+                     "/threads:%zu", instance->threads);
+        }
+        instance->name = instance->instance_name;
+
+        instance->next = previous->next;
+        previous->next = instance;
+        if (registry()->tail == previous) {
+            registry()->tail = instance;
+        }
+
+        registry()->size++;
+        previous = instance;
+    }
+}
+
+static void fit_family(benchmark_t* family) {
+    assert(family);
+
+    if (family->complexity == COMPLEXITY_NONE || !family->expanded || !family->points_cnt) {
+        return;
+    }
+
+    int64_t* n = (int64_t*) calloc(family->points_cnt, sizeof(int64_t));
+    double* time = (double*) calloc(family->points_cnt, sizeof(double));
+
+    // With a thread sweep the curve is fitted over the smallest thread count only.
+    size_t threads = family->thread_counts_cnt ? family->thread_counts[0] : family->threads;
+
+    if (!n || !time) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        free(n);
+        free(time);
+        return;
+    }
+
+    size_t points_cnt = 0;
+
+    for (benchmark_t* instance = family->next; instance && instance->family == family; instance = instance->next) {
+        if (!instance->testing_results.tests_cnt || instance->threads != threads) {
+            continue;
+        }
+
+        n[points_cnt] = instance->complexity_n;
+        time[points_cnt] = instance->testing_results.average_time;
+        points_cnt++;
+
+        family->timer = instance->timer;
+    }
+
+    family->complexity_fit = fit_complexity(n, time, points_cnt, family->complexity);
+
+    free(n);
+    free(time);
+
+    if (family->complexity_fit.complexity != COMPLEXITY_NONE) {
+        report_complexity(family);
+    }
+}
+
+// Speedup and efficiency of every instance against the instance with the same arguments and the
+// smallest thread count, which comes first among them.
+static void scale_family(benchmark_t* family) {
+    assert(family);
+
+    if (family->thread_counts_cnt < 2 || !family->expanded) {
+        return;
+    }
+
+    const benchmark_t* reference = nullptr;
+
+    for (benchmark_t* instance = family->next; instance && instance->family == family; instance = instance->next) {
+        if (!reference || !same_args(reference, instance)) {
+            reference = instance;
+        }
+
+        testing_results_t* results = &instance->testing_results;
+        double reference_throughput = reference->testing_results.throughput;
+
+        if (!results->tests_cnt || reference_throughput <= 0) {
+            continue;
+        }
+
+        results->speedup = results->throughput / reference_throughput;
+        results->efficiency = results->speedup * (double) reference->threads / (double) instance->threads;
+
+        family->timer = instance->timer;
+    }
+
+    report_scaling(family);
 }
 
 static void initialize_benchmark() {
+    warmup_config_t* warmup = &benchmark()->warmup;
+
+    // A steady-state warmup is bounded by the fixed duration it replaces.
+    if (warmup->steady_state) {
+        if (benchmark()->min_warmup_time == 0) {
+            benchmark()->min_warmup_time = STEADY_MIN_WARMUP_TIME;
+        }
+        if (warmup->max_time == 0) {
+            warmup->max_time = MIN_WARMUP_TIME;
+        }
+        if (warmup->max_time < benchmark()->min_warmup_time) {
+            warmup->max_time = benchmark()->min_warmup_time;
+        }
+        if (warmup->tolerance <= 0) {
+            warmup->tolerance = STEADY_STATE_TOLERANCE;
+        }
+    }
+
     if (benchmark()->min_warmup_time == 0) {
         benchmark()->min_warmup_time = MIN_WARMUP_TIME;
     }
@@ -65,38 +674,730 @@ static void initialize_benchmark() {
     if (benchmark()->max_test_time == 0) {
         benchmark()->max_test_time = MAX_TEST_TIME;
     }
+
+    if (benchmark()->sample_time == 0) {
+        benchmark()->sample_time = SAMPLE_TIME;
+    }
+
+    if (benchmark()->max_samples == 0) {
+        benchmark()->max_samples = MAX_SAMPLES;
+    }
+
+    precision_config_t* precision = &benchmark()->precision;
+
+    if (compare_doubles(precision->confidence, 0)) {
+        precision->confidence = DEFAULT_CONFIDENCE;
+    }
+
+    // Every sample the rule may ask for is kept after the two control groups, the median interval is
+    // computed over them.
+    if (precision->max_samples && precision->max_samples + 2 * CONTROL_GROUP_SIZE > benchmark()->max_samples) {
+        benchmark()->max_samples = precision->max_samples + 2 * CONTROL_GROUP_SIZE;
+    }
+
+    if (precision->target > 0 && precision->statistic == PRECISION_MEDIAN && benchmark()->async_samples) {
+        LOG(WARNING, "The median interval of \"%s\" needs the samples on the measuring thread, "
+                     "using the mean instead\n", benchmark()->name);
+        precision->statistic = PRECISION_MEAN;
+    }
+
+    if (benchmark()->threads == 0) {
+        benchmark()->threads = 1;
+    }
+
+    // The baseline is measured on the calling thread alone, without the handoff through the thread pool.
+    if (benchmark()->subtract_baseline && benchmark()->threads > 1) {
+        LOG(WARNING, "The baseline of \"%s\" is calibrated on one thread and isn't subtracted on %zu threads\n",
+                     benchmark()->name, benchmark()->threads);
+        benchmark()->subtract_baseline = false;
+    }
+
+    if (benchmark()->track_allocations && !alloc_tracking_available()) {
+        static bool warned = false;
+
+        if (!warned) {
+            LOG(WARNING, "Allocation tracking needs a build with -DBENCHMARK_TRACK_ALLOCATIONS\n");
+            warned = true;
+        }
+        benchmark()->track_allocations = false;
+    }
+
+    if (benchmark()->context_func && (benchmark()->iteration_setup || benchmark()->iteration_teardown)) {
+        LOG(WARNING, "Iteration fixtures of \"%s\" are ignored, a context benchmark runs its iterations itself "
+                     "and can use pause_timing() / resume_timing()\n", benchmark()->name);
+    }
+
+    if (benchmark()->threads > 1 && benchmark()->timer == TIMER_THREAD_CPUTIME) {
+        LOG(WARNING, "Thread CPU time can't measure \"%s\" on %zu threads, using monotonic raw time\n",
+                     benchmark()->name, benchmark()->threads);
+        benchmark()->timer = TIMER_MONOTONIC_RAW;
+    }
+
+    timer_set_backend(benchmark()->timer);
+    benchmark()->timer = timer_backend();
+    benchmark()->ns_per_tick = timer_ticks_to_ns(1);
+}
+
+static void set_warmup_results(test_t* results) {
+    benchmark()->warmup_results.time = results->wall_time;
+    benchmark()->warmup_results.tests_cnt = results->tests_cnt;
+    benchmark()->warmup_results.steady_state = benchmark()->warmup.steady_state;
+}
+
+static void set_begin_results(test_t* results) {
+    benchmark()->begin_results.time = results->total_time;
+    benchmark()->begin_results.tests_cnt = results->tests_cnt;
+}
+
+static void set_testing_results(test_t* results) {
+    benchmark()->testing_results.time = results->total_time;
+    benchmark()->testing_results.tests_cnt = results->tests_cnt;
+    benchmark()->testing_results.iterations = benchmark()->iterations;
+    benchmark()->testing_results.average_time = (double) results->total_time /
+                                                ((double) results->tests_cnt * benchmark()->iterations);
+    benchmark()->testing_results.average_relative_deviation = group_deviation()->average;
+
+    double baseline = iteration_baseline();
+
+    benchmark()->testing_results.baseline = baseline;
+    benchmark()->testing_results.baseline_subtracted = benchmark()->subtract_baseline;
+    benchmark()->testing_results.timer_overhead = overhead()->sample_overhead;
+    benchmark()->testing_results.pause_overhead = overhead()->pause_overhead;
+    benchmark()->testing_results.clamped_samples = results->clamped_cnt;
+
+    if (results->clamped_cnt) {
+        LOG(WARNING, "%zu of %zu samples of \"%s\" came out at 0 after subtracting the pauses, the pause "
+                     "overhead of %f ticks is close to the cost of the timed work between them\n",
+                     results->clamped_cnt, results->tests_cnt, benchmark()->name, overhead()->pause_overhead);
+    }
+
+    if (benchmark()->subtract_baseline) {
+        benchmark()->testing_results.average_time = fmax(benchmark()->testing_results.average_time - baseline, 0);
+    }
+
+    set_thread_results(results);
+
+    perf_counters_read(perf_counters(), (double) results->tests_cnt * (double) benchmark()->iterations,
+                       &benchmark()->testing_results.counters);
+    set_allocations_results(results);
+    set_rate_results(results);
+
+    compute_statistics(benchmark()->samples.data, benchmark()->samples.size, &benchmark()->testing_results.stats,
+                       !*repetition_child());
+
+    if (benchmark()->precision.target > 0) {
+        precision_update();
+        benchmark()->testing_results.precision = precision_tracker()->results;
+    }
+    else {
+        benchmark()->testing_results.precision = {};
+    }
+}
+
+// Samples of a multi-threaded benchmark are wall times of a batch run by all threads together,
+// the time each thread spent on its own share is kept by the thread pool.
+static void set_thread_results(test_t* results) {
+    testing_results_t* testing = &benchmark()->testing_results;
+    size_t threads = benchmark()->threads;
+    double iterations = (double) results->tests_cnt * (double) benchmark()->iterations;
+
+    testing->threads = threads;
+    testing->thread_time_min = (double) results->total_time / iterations;
+    testing->thread_time_max = testing->thread_time_min;
+
+    if (threads > 1 && thread_pool()->threads == threads) {
+        for (size_t i = 0; i < threads; i++) {
+            double thread_time = (double) thread_pool()->totals[i] / iterations;
+
+            testing->thread_time_min = i ? fmin(testing->thread_time_min, thread_time) : thread_time;
+            testing->thread_time_max = i ? fmax(testing->thread_time_max, thread_time) : thread_time;
+        }
+    }
+
+    double seconds = (double) results->total_time * benchmark()->ns_per_tick / NS_PER_SEC;
+    testing->throughput = seconds > 0 ? iterations * (double) threads / seconds : 0;
+}
+
+static void set_rate_results(test_t* results) {
+    testing_results_t* testing = &benchmark()->testing_results;
+    double seconds = (double) results->total_time * benchmark()->ns_per_tick / NS_PER_SEC;
+    double iterations = (double) results->tests_cnt * (double) benchmark()->iterations * (double) benchmark()->threads;
+
+    testing->bytes_per_second = seconds > 0 ? benchmark()->bytes_processed / seconds : 0;
+    testing->items_per_second = seconds > 0 ? benchmark()->items_processed / seconds : 0;
+    testing->user_counters_cnt = benchmark()->counter_totals_cnt;
+
+    for (size_t i = 0; i < benchmark()->counter_totals_cnt; i++) {
+        user_counter_t counter = benchmark()->counter_totals[i];
+
+        if (counter.kind == USER_COUNTER_AVERAGE) {
+            counter.value = iterations > 0 ? counter.value / iterations : 0;
+        }
+        else if (counter.kind == USER_COUNTER_RATE) {
+            counter.value = seconds > 0 ? counter.value / seconds : 0;
+        }
+
+        testing->user_counters[i] = counter;
+    }
+}
+
+// Allocations of all threads are counted together, so they are per iteration of all of them.
+static void set_allocations_results(test_t* results) {
+    allocations_results_t* allocations = &benchmark()->testing_results.allocations;
+    *allocations = {};
+
+    if (!benchmark()->track_allocations) {
+        return;
+    }
+
+    alloc_stats_t stats = {};
+    alloc_tracking_stats(&stats);
+
+    double iterations = (double) results->tests_cnt * (double) benchmark()->iterations * (double) benchmark()->threads;
+
+    allocations->measured = true;
+    allocations->allocations = (double) stats.allocations / iterations;
+    allocations->frees = (double) stats.frees / iterations;
+    allocations->bytes = (double) stats.bytes_allocated / iterations;
+    allocations->peak_live_bytes = stats.peak_live_bytes;
+}
+
+//============================================================================================================
+
+static bool run_current() {
+    if ((!benchmark()->func && !benchmark()->context_func) || is_family(benchmark())) {
+        return false;
+    }
+
+    if (benchmark()->repetitions > 1) {
+        return run_repetitions();
+    }
+
+    return run_once();
 }
 
-static void set_warmup_results(test_t* results) {
-    benchmark()->warmup_results.time = results->total_time;
-    benchmark()->warmup_results.tests_cnt = results->tests_cnt;
-}
+static bool run_once() {
+    initialize_benchmark();
+
+    size_t threads = benchmark()->threads;
+    if (threads > 1 && !thread_pool_ctor(thread_pool(), threads, run_batch, thread_batch())) {
+        return false;
+    }
+
+    // Workers are started first so that they don't inherit the affinity of the pinned thread: pinning all of
+    // them to one CPU would serialize them. They stay unpinned and keep the default priority.
+    environment_setup(&benchmark()->environment_config, &benchmark()->environment);
+    calibrate_overhead();
+
+    if (benchmark()->perf_counters) {
+        perf_counters_open(perf_counters());
+    }
+
+    prepare_arena();
+    run_warmup();
+    run_testing();
+    release_arena();
+
+    perf_counters_close(perf_counters());
+    environment_restore();
+
+    if (threads > 1) {
+        thread_pool_dtor(thread_pool());
+    }
+
+    return true;
+}
+
+//============================================================================================================
+
+// Every repetition runs the whole warmup and testing cycle in a fresh child process, so that heap
+// layout, ASLR and code alignment differ between them. The samples of all repetitions are pooled for
+// the statistics, the average times of the repetitions are summarized separately.
+static bool run_repetitions() {
+    initialize_benchmark();
+
+    // Calibrated once here, the forked repetitions inherit it instead of measuring it again.
+    calibrate_overhead();
+
+    benchmark_t* bm = benchmark();
+
+    double* times = (double*) realloc(bm->repetition_times, bm->repetitions * sizeof(double));
+    if (!times) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return false;
+    }
+    bm->repetition_times = times;
+
+    // Grows with the samples the repetitions actually send.
+    samples_t pooled = {};
+    histogram_t histogram = {};
+
+    histogram_reset(&bm->histogram);
+
+    repetition_message_t message = {};
+    size_t completed = 0;
+
+    for (size_t i = 0; i < bm->repetitions; i++) {
+        if (!run_repetition(&pooled, &histogram, &message)) {
+            LOG(ERROR, "Repetition %zu of \"%s\" failed\n", i + 1, bm->name);
+            continue;
+        }
+
+        times[completed++] = message.testing_results.average_time;
+    }
+
+    if (!completed) {
+        samples_dtor(&pooled);
+        return false;
+    }
+
+    bm->samples.swap(pooled);
+    samples_dtor(&pooled);
+
+    bm->testing_results.repetitions.repetitions = completed;
+    set_repetitions_results(&message);
+    return true;
+}
+
+static bool run_repetition(samples_t* pooled, histogram_t* histogram, repetition_message_t* message) {
+    int fds[2] = {};
+
+    if (pipe(fds)) {
+        LOG(ERROR, "Can't create a pipe: %s\n", strerror(errno));
+        return false;
+    }
+
+    // Anything buffered before the fork would be written twice.
+    fflush(nullptr);
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        LOG(ERROR, "Can't fork a repetition: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        *repetition_child() = true;
+
+        bool sent = run_once() && send_repetition(fds[1]);
+        LoggerFlush();
+        fflush(nullptr);
+        _exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    bool received = receive_repetition(fds[0], pooled, histogram, message);
+    close(fds[0]);
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        return false;
+    }
+
+    return received;
+}
+
+static bool send_repetition(int fd) {
+    benchmark_t* bm = benchmark();
+
+    repetition_message_t message = {};
+    message.warmup_results = bm->warmup_results;
+    message.begin_results = bm->begin_results;
+    message.testing_results = bm->testing_results;
+    message.environment = bm->environment;
+    message.iterations = bm->iterations;
+    message.timer = bm->timer;
+    message.ns_per_tick = bm->ns_per_tick;
+    message.complexity_n = bm->complexity_n;
+    message.samples_cnt = bm->samples.size;
+
+    return write_all(fd, &message, sizeof(message)) &&
+           write_all(fd, bm->samples.data, bm->samples.size * sizeof(double)) &&
+           write_all(fd, &bm->histogram, sizeof(histogram_t));
+}
+
+// Up to max_samples per repetition are pooled, the samples past that are read and dropped. histogram is
+// the buffer the histogram of the repetition is read into.
+static bool receive_repetition(int fd, samples_t* pooled, histogram_t* histogram, repetition_message_t* message) {
+    if (!read_all(fd, message, sizeof(repetition_message_t))) {
+        return false;
+    }
+
+    benchmark_t* bm = benchmark();
+    size_t limit = bm->max_samples * bm->repetitions;
+
+    size_t kept = limit > pooled->size ? limit - pooled->size : 0;
+    if (kept > message->samples_cnt) {
+        kept = message->samples_cnt;
+    }
+
+    if (!pooled->reserve(pooled->size + kept)) {
+        return false;
+    }
+
+    if (!read_all(fd, pooled->data + pooled->size, kept * sizeof(double))) {
+        return false;
+    }
+    pooled->size += kept;
+
+    for (size_t i = kept; i < message->samples_cnt; i++) {
+        double sample = 0;
+        if (!read_all(fd, &sample, sizeof(double))) {
+            return false;
+        }
+    }
+
+    if (!read_all(fd, histogram, sizeof(histogram_t))) {
+        return false;
+    }
+
+    histogram_merge(&bm->histogram, histogram);
+    return true;
+}
+
+static void set_repetitions_results(const repetition_message_t* last) {
+    benchmark_t* bm = benchmark();
+
+    bm->warmup_results = last->warmup_results;
+    bm->begin_results = last->begin_results;
+    bm->environment = last->environment;
+    bm->iterations = last->iterations;
+    bm->timer = last->timer;
+    bm->ns_per_tick = last->ns_per_tick;
+    bm->complexity_n = last->complexity_n;
+
+    repetitions_results_t repetitions = bm->testing_results.repetitions;
+    bm->testing_results = last->testing_results;
+
+    size_t completed = repetitions.repetitions;
+    double* times = bm->repetition_times;
+    double sum = 0;
+    double squares = 0;
+
+    for (size_t i = 0; i < completed; i++) {
+        sum += times[i];
+    }
+
+    repetitions.mean = sum / (double) completed;
+
+    for (size_t i = 0; i < completed; i++) {
+        squares += (times[i] - repetitions.mean) * (times[i] - repetitions.mean);
+    }
+
+    repetitions.stddev = completed > 1 ? sqrt(squares / (double) (completed - 1)) : 0;
+
+    double* sorted = (double*) calloc(completed, sizeof(double));
+    if (sorted) {
+        memcpy(sorted, times, completed * sizeof(double));
+        qsort(sorted, completed, sizeof(double), compare_sample_doubles);
+
+        repetitions.median = percentile(sorted, completed, 0.5);
+        repetitions.min = sorted[0];
+        repetitions.max = sorted[completed - 1];
+        free(sorted);
+    }
+
+    bm->testing_results.repetitions = repetitions;
+    bm->testing_results.average_time = repetitions.mean;
+
+    compute_statistics(bm->samples.data, bm->samples.size, &bm->testing_results.stats);
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*) data;
+
+    while (size) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+
+        bytes += written;
+        size -= (size_t) written;
+    }
+
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size) {
+    char* bytes = (char*) data;
+
+    while (size) {
+        ssize_t bytes_read = read(fd, bytes, size);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return false;
+        }
+
+        bytes += bytes_read;
+        size -= (size_t) bytes_read;
+    }
+
+    return true;
+}
+
+//============================================================================================================
+
+static bool run_and_report(benchmark_t* bm) {
+    registry()->current = bm;
+
+    if (!run_current()) {
+        return false;
+    }
+
+    report_benchmark(bm);
+    return true;
+}
+
+void run_benchmark() {
+    benchmark_t* bm = benchmark();
+    expand_family(bm);
+
+    report_begin();
+
+    if (is_family(bm)) {
+        for (benchmark_t* instance = bm->next; instance && instance->family == bm; instance = instance->next) {
+            run_and_report(instance);
+        }
+
+        fit_family(bm);
+        scale_family(bm);
+    }
+    else {
+        run_and_report(bm);
+    }
+
+    report_end();
+
+    registry()->current = bm;
+}
+
+size_t run_benchmarks(const char* filter) {
+    regex_t regex = {};
+
+    if (filter && regcomp(&regex, filter, REG_EXTENDED | REG_NOSUB)) {
+        LOG(ERROR, "Invalid benchmark filter \"%s\"\n", filter);
+        return 0;
+    }
+
+    size_t benchmarks_cnt = 0;
+
+    for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        expand_family(bm);
+    }
+
+    report_begin();
+
+    for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        if (filter && regexec(&regex, bm->name, 0, nullptr, 0)) {
+            continue;
+        }
+
+        benchmarks_cnt += run_and_report(bm);
+    }
+
+    for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        if (is_family(bm)) {
+            fit_family(bm);
+            scale_family(bm);
+        }
+    }
+
+    report_end();
+
+    if (filter) {
+        regfree(&regex);
+    }
 
-static void set_begin_results(test_t* results) {
-    benchmark()->begin_results.time = results->total_time;
-    benchmark()->begin_results.tests_cnt = results->tests_cnt;
+    return benchmarks_cnt;
 }
 
-static void set_testing_results(test_t* results) {
-    benchmark()->testing_results.time = results->total_time;
-    benchmark()->testing_results.tests_cnt = results->tests_cnt;
-    benchmark()->testing_results.average_time = (double) results->total_time / results->tests_cnt;
-    benchmark()->testing_results.average_relative_deviation = group_deviation()->average;
-}
+int benchmark_main(int argc, char* argv[]) {
+    const char* filter = nullptr;
+    const char* save_path = nullptr;
+    const char* compare_path = nullptr;
+    compare_config_t compare_config = {COMPARE_WELCH, COMPARE_ALPHA, COMPARE_THRESHOLD};
+    bool list_only = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = nullptr;
+
+        if ((value = option_value(argv[i], "--filter"))) {
+            filter = value;
+        }
+        else if (!strcmp(argv[i], "--list")) {
+            list_only = true;
+        }
+        else if ((value = option_value(argv[i], "--format"))) {
+            if (!set_report_format(value)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if ((value = option_value(argv[i], "--out"))) {
+            if (!set_report_file(value)) {
+                return 1;
+            }
+        }
+        else if ((value = option_value(argv[i], "--save-baseline"))) {
+            save_path = value;
+        }
+        else if ((value = option_value(argv[i], "--compare"))) {
+            compare_path = value;
+        }
+        else if ((value = option_value(argv[i], "--compare-test"))) {
+            if (!set_compare_test(&compare_config, value)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if ((value = option_value(argv[i], "--alpha"))) {
+            compare_config.alpha = atof(value);
+        }
+        else if ((value = option_value(argv[i], "--threshold"))) {
+            compare_config.threshold = atof(value);
+        }
+        else if (!strcmp(argv[i], "--subtract-baseline")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->subtract_baseline = true;
+            }
+        }
+        else if (!strcmp(argv[i], "--check-environment")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->environment_config.enabled = true;
+            }
+        }
+        else if ((value = option_value(argv[i], "--pin-cpu"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->environment_config = {true, true, atoi(value), bm->environment_config.raise_priority};
+            }
+        }
+        else if ((value = option_value(argv[i], "--repetitions"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->repetitions = (size_t) atol(value);
+            }
+        }
+        else if ((value = option_value(argv[i], "--precision"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->precision.target = atof(value);
+            }
+        }
+        else if ((value = option_value(argv[i], "--confidence"))) {
+            double confidence = atof(value);
+            if (confidence <= 0 || confidence >= 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->precision.confidence = confidence;
+            }
+        }
+        else if ((value = option_value(argv[i], "--precision-statistic"))) {
+            if (strcmp(value, "mean") && strcmp(value, "median")) {
+                print_usage(argv[0]);
+                return 1;
+            }
+
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->precision.statistic = strcmp(value, "median") ? PRECISION_MEAN : PRECISION_MEDIAN;
+            }
+        }
+        else if ((value = option_value(argv[i], "--min-samples"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->precision.min_samples = (size_t) atol(value);
+            }
+        }
+        else if ((value = option_value(argv[i], "--max-samples"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->precision.max_samples = (size_t) atol(value);
+            }
+        }
+        else if (!strcmp(argv[i], "--steady-warmup")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->warmup.steady_state = true;
+            }
+        }
+        else if ((value = option_value(argv[i], "--max-warmup-time"))) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->warmup.max_time = (uint64_t) (atof(value) * NS_PER_SEC);
+            }
+        }
+        else if (!strcmp(argv[i], "--huge-pages")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->huge_pages = true;
+            }
+        }
+        else if (!strcmp(argv[i], "--async-samples")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->async_samples = true;
+            }
+        }
+        else if (!strcmp(argv[i], "--async-log")) {
+            LoggerStartAsync(LOG_DEFAULT_QUEUE_CAPACITY, LOG_OVERFLOW_DROP);
+        }
+        else if (!strcmp(argv[i], "--track-allocations")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->track_allocations = true;
+            }
+        }
+        else if (!strcmp(argv[i], "--perf-counters")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->perf_counters = true;
+            }
+        }
+        else if (!strcmp(argv[i], "--raise-priority")) {
+            for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+                bm->environment_config.enabled = true;
+                bm->environment_config.raise_priority = true;
+            }
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
 
-//============================================================================================================
+    if (list_only) {
+        for (benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+            expand_family(bm);
 
-void run_benchmark() {
-    if (!benchmark()->func) {
-        return;
+            if (!is_family(bm)) {
+                fprintf(stdout, "%s\n", bm->name);
+            }
+        }
+        return 0;
     }
 
-    initialize_benchmark();
+    run_benchmarks(filter);
 
-    run_warmup();
-    run_testing();
+    FILE* compare_out = report_text_stream();
+    set_report_file(nullptr);
+
+    if (save_path && !baseline_save(save_path)) {
+        return 1;
+    }
+
+    if (compare_path) {
+        long regressions_cnt = baseline_compare(compare_path, &compare_config, compare_out);
+        if (regressions_cnt < 0) {
+            return 1;
+        }
+        if (regressions_cnt > 0) {
+            return EXIT_REGRESSION;
+        }
+    }
 
-    print_report();
+    return 0;
 }
 
 //============================================================================================================
@@ -108,7 +1409,7 @@ static void initialize_test_info(test_t* test, state_t state) {
 
     switch (state) {
         case WARMUP:
-            test->set_time = benchmark()->min_warmup_time;
+            test->set_time = timer_ns_to_ticks(benchmark()->min_warmup_time);
             test->set_iterations = 0;
             break;
         case BEGIN:
@@ -129,29 +1430,428 @@ static void initialize_test_info(test_t* test, state_t state) {
 
 //============================================================================================================
 
-static clock_t run_test(state_t state) {
-    clock_t start = clock();
-    benchmark()->func(state);
-    clock_t end = clock();
+// Hardware counters cover the testing samples of the calling thread, they are switched on and off
+// outside the timer pair.
+// Returns the active time of the sample. wall_time, if given, also counts the paused parts; it is what
+// the iteration calibration and the time limits go by, so that a mostly paused body still finishes.
+static ticks_t run_test(state_t state, ticks_t* wall_time) {
+    ticks_t test_time = 0;
+    ticks_t wall = 0;
+
+    // The threads pause independently, only the longest paused part is surely not in the wall time.
+    if (benchmark()->threads > 1) {
+        thread_batch()->bm = benchmark();
+        thread_batch()->state = state;
+        thread_batch()->max_paused = 0;
+
+        wall = thread_pool_run(thread_pool());
+        test_time = wall > thread_batch()->max_paused ? wall - thread_batch()->max_paused : 0;
+    }
+    else {
+        thread_batch_t batch = {benchmark(), state, 0, 0};
+        test_time = run_batch(0, &batch);
+        wall = batch.wall_time;
+    }
+
+    if (wall_time) {
+        *wall_time = wall;
+    }
+
+    return test_time;
+}
+
+// Fixtures run outside the timer pair. Iteration fixtures of a state_t benchmark run inside it, around
+// every call, with the timing paused.
+static ticks_t run_batch(size_t thread_index, void* arg) {
+    thread_batch_t* batch = (thread_batch_t*) arg;
+    benchmark_t* bm = batch->bm;
+    size_t iterations = bm->iterations;
+
+    context_t ctx = {};
+    ctx.state = batch->state;
+    ctx.iterations = iterations;
+    ctx.args = bm->args;
+    ctx.args_cnt = bm->args_cnt;
+    ctx.complexity_n = bm->complexity_n;
+    ctx.thread_index = thread_index;
+    ctx.threads = bm->threads ? bm->threads : 1;
+    ctx.data = bm->fixture_data;
+
+    // Only the body is tracked, allocations of the library itself between samples are not counted.
+    ctx.tracking_allocations = bm->track_allocations && batch->state != WARMUP;
+
+    // The counters belong to the calling thread and cover its timed region only, without the fixtures,
+    // the pauses and the waits of the thread pool.
+    bool counting = thread_index == 0 && batch->state != WARMUP && perf_counters()->opened;
+    ctx.perf_counters = counting ? perf_counters() : nullptr;
+
+    if (bm->setup) {
+        bm->setup(&ctx);
+    }
+
+    if (ctx.tracking_allocations) {
+        alloc_tracking_begin();
+    }
+
+    if (counting) {
+        perf_counters_enable(perf_counters());
+    }
+
+    ticks_t start = 0;
+    ticks_t end = 0;
+
+    if (bm->context_func) {
+        context_func_t context_func = bm->context_func;
+
+        start = timer_start();
+        context_func(&ctx);
+        end = timer_stop();
+    }
+    else if (bm->iteration_setup || bm->iteration_teardown) {
+        test_func_t func = bm->func;
+        fixture_func_t setup = bm->iteration_setup;
+        fixture_func_t teardown = bm->iteration_teardown;
+        state_t state = batch->state;
+
+        start = timer_start();
+        for (size_t i = 0; i < iterations; i++) {
+            if (setup) {
+                pause_timing(&ctx);
+                setup(&ctx);
+                resume_timing(&ctx);
+            }
+
+            func(state);
+
+            if (teardown) {
+                pause_timing(&ctx);
+                teardown(&ctx);
+                resume_timing(&ctx);
+            }
+        }
+        end = timer_stop();
+    }
+    else {
+        test_func_t func = bm->func;
+        state_t state = batch->state;
+
+        start = timer_start();
+        for (size_t i = 0; i < iterations; i++) {
+            func(state);
+        }
+        end = timer_stop();
+    }
+
+    if (counting) {
+        perf_counters_disable(perf_counters());
+    }
+
+    if (ctx.tracking_allocations) {
+        alloc_tracking_end();
+    }
+
+    if (bm->teardown) {
+        bm->teardown(&ctx);
+    }
+
+    if (thread_index == 0) {
+        bm->complexity_n = ctx.complexity_n;
+        bm->fixture_data = ctx.data;
+        batch->wall_time = end - start;
+    }
+
+    if (batch->state != WARMUP) {
+        add_processed(bm, &ctx);
+    }
+
+    if (bm->threads > 1 && ctx.pauses_cnt) {
+        record_paused(batch, &ctx);
+    }
+
+    return active_time(&ctx, start, end);
+}
+
+// Bytes and items the body didn't report default to the per-iteration amounts of the benchmark.
+static void add_processed(benchmark_t* bm, const context_t* ctx) {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    bool shared = bm->threads > 1;
+    if (shared) {
+        pthread_mutex_lock(&mutex);
+    }
+
+    int64_t iterations = (int64_t) ctx->iterations;
+
+    bm->bytes_processed += (double) (ctx->bytes_processed ? ctx->bytes_processed : bm->bytes_per_iteration * iterations);
+    bm->items_processed += (double) (ctx->items_processed ? ctx->items_processed : bm->items_per_iteration * iterations);
+
+    for (size_t i = 0; i < ctx->counters_cnt; i++) {
+        const user_counter_t* counter = &ctx->counters[i];
+        size_t total = 0;
+
+        while (total < bm->counter_totals_cnt && strcmp(bm->counter_totals[total].name, counter->name)) {
+            total++;
+        }
+
+        if (total == bm->counter_totals_cnt) {
+            if (total == BENCHMARK_MAX_COUNTERS) {
+                continue;
+            }
+
+            bm->counter_totals[bm->counter_totals_cnt++] = {counter->name, counter->kind, 0};
+        }
+
+        bm->counter_totals[total].value += counter->value;
+    }
+
+    if (shared) {
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+static void reset_processed(benchmark_t* bm) {
+    bm->bytes_processed = 0;
+    bm->items_processed = 0;
+    bm->counter_totals_cnt = 0;
+}
+
+static ticks_t active_time(const context_t* ctx, ticks_t start, ticks_t end) {
+    if (!ctx->pauses_cnt) {
+        return end - start;
+    }
+
+    double active = (double) (end - start) - paused_time(ctx);
+
+    return active > 0 ? (ticks_t) active : 0;
+}
+
+// The paused time with the cost of the pause_timing() / resume_timing() pairs.
+static double paused_time(const context_t* ctx) {
+    return (double) ctx->paused_time + (double) ctx->pauses_cnt * overhead()->pause_overhead;
+}
+
+static void record_paused(thread_batch_t* batch, const context_t* ctx) {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    ticks_t paused = (ticks_t) paused_time(ctx);
+
+    pthread_mutex_lock(&mutex);
+    if (paused > batch->max_paused) {
+        batch->max_paused = paused;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+static thread_pool_t* thread_pool() {
+    static thread_pool_t thread_pool = {};
+    return &thread_pool;
+}
+
+static thread_batch_t* thread_batch() {
+    static thread_batch_t thread_batch = {};
+    return &thread_batch;
+}
+
+static perf_counters_t* perf_counters() {
+    static perf_counters_t perf_counters = {};
+    return &perf_counters;
+}
+
+//============================================================================================================
+
+static overhead_t* overhead() {
+    static overhead_t overhead = {};
+    return &overhead;
+}
+
+// Set in the forked repetition processes, whose statistics the parent recomputes over the pooled samples.
+static bool* repetition_child() {
+    static bool child = false;
+    return &child;
+}
+
+static void empty_test(state_t) {}
+
+static void empty_context(context_t*) {}
+
+static void empty_pauses(context_t* ctx) {
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        pause_timing(ctx);
+        resume_timing(ctx);
+    }
+}
+
+// Runs empty bodies through run_test() exactly as a benchmark would be run: the timer pair and the
+// call through context_func_t give the per-test overhead, a batch of test_func_t calls gives the
+// per-call overhead on top of it, and a batch of empty pauses the part of a pause_timing() /
+// resume_timing() pair that the paused time misses. Repeated only when the timer backend changes.
+static void calibrate_overhead() {
+    if (overhead()->calibrated && overhead()->timer == timer_backend()) {
+        return;
+    }
+
+    static benchmark_t empty = {};
+
+    benchmark_t* measured = registry()->current;
+    registry()->current = &empty;
+
+    empty.context_func = empty_context;
+    empty.iterations = 1;
+    double sample_overhead = median_test_time(OVERHEAD_TESTS_CNT);
+
+    empty.context_func = nullptr;
+    empty.func = empty_test;
+    empty.iterations = OVERHEAD_ITERATIONS;
+    double batch_time = median_test_time(OVERHEAD_TESTS_CNT);
+
+    empty.context_func = empty_pauses;
+    overhead()->pause_overhead = 0;
+    double pauses_time = median_test_time(OVERHEAD_TESTS_CNT);
+
+    registry()->current = measured;
+
+    overhead()->calibrated = true;
+    overhead()->timer = timer_backend();
+    overhead()->sample_overhead = sample_overhead;
+    overhead()->call_overhead = fmax(batch_time - sample_overhead, 0) / OVERHEAD_ITERATIONS;
+    overhead()->pause_overhead = fmax(pauses_time - sample_overhead, 0) / OVERHEAD_ITERATIONS;
+}
+
+static double iteration_baseline() {
+    double baseline = overhead()->sample_overhead / (double) benchmark()->iterations;
+    if (!benchmark()->context_func) {
+        baseline += overhead()->call_overhead;
+    }
+
+    return baseline;
+}
+
+static double median_test_time(size_t tests_cnt) {
+    assert(tests_cnt <= OVERHEAD_TESTS_CNT);
+
+    ticks_t times[OVERHEAD_TESTS_CNT] = {};
+
+    for (size_t i = 0; i < tests_cnt; i++) {
+        times[i] = run_test(WARMUP);
+    }
+
+    qsort(times, tests_cnt, sizeof(ticks_t), compare_ticks);
+    return (double) times[tests_cnt / 2];
+}
+
+//============================================================================================================
+
+// Grows the number of iterations per sample until one sample takes at least sample_time,
+// so that the timer resolution and the cost of reading it are amortized over the batch.
+static void calibrate_iterations(test_t* warmup) {
+    assert(warmup);
+
+    ticks_t target_time = timer_ns_to_ticks((double) benchmark()->sample_time);
+    ticks_t duration = 0;
+
+    benchmark()->iterations = 1;
+
+    while (true) {
+        warmup->total_time += run_test(warmup->state, &duration);
+        warmup->wall_time += duration;
+        warmup->tests_cnt++;
+        warmup->iterations_cnt += benchmark()->iterations;
+
+        size_t iterations = benchmark()->iterations;
+        if (duration >= target_time || iterations >= MAX_ITERATIONS) {
+            break;
+        }
+
+        double growth = MAX_ITERATIONS_GROWTH;
+        if (duration > 0) {
+            growth = fmin(ITERATIONS_GROWTH_MARGIN * (double) target_time / (double) duration, MAX_ITERATIONS_GROWTH);
+        }
 
-    return end - start;
+        size_t next_iterations = (size_t) ((double) iterations * growth);
+        if (next_iterations <= iterations) {
+            next_iterations = iterations + 1;
+        }
+
+        benchmark()->iterations = next_iterations < MAX_ITERATIONS ? next_iterations : MAX_ITERATIONS;
+    }
 }
 
 static void run_warmup() {
     test_t warmup = {};
     initialize_test_info(&warmup, WARMUP);
 
-    clock_t duration = 0;
+    benchmark()->warmup_results = {};
+    calibrate_iterations(&warmup);
+
+    if (benchmark()->warmup.steady_state) {
+        run_steady_warmup(&warmup);
+        set_warmup_results(&warmup);
+        return;
+    }
+
+    ticks_t duration = 0;
 
-    while (warmup.total_time < warmup.set_time) {
-        duration = run_test(warmup.state);
-        warmup.total_time += duration;
+    while (warmup.wall_time < warmup.set_time) {
+        warmup.total_time += run_test(warmup.state, &duration);
+        warmup.wall_time += duration;
         warmup.tests_cnt++;
     }
 
     set_warmup_results(&warmup);
 }
 
+// Keeps the per-iteration times of the last STEADY_STATE_WINDOW tests, all of them at the calibrated
+// iteration count, and ends once their segment medians agree within the tolerance and min_warmup_time
+// has passed. The window is checked after every test, and the reported point is where it last became
+// steady. A window that never settles is cut at max_time.
+static void run_steady_warmup(test_t* warmup) {
+    const warmup_config_t* config = &benchmark()->warmup;
+    warmup_results_t* results = &benchmark()->warmup_results;
+
+    ticks_t max_time = timer_ns_to_ticks((double) config->max_time);
+    double window[STEADY_STATE_WINDOW] = {};
+    double scratch[STEADY_STATE_WINDOW] = {};
+    size_t window_cnt = 0;
+    ticks_t duration = 0;
+
+    while (warmup->wall_time < max_time) {
+        ticks_t test_time = run_test(warmup->state, &duration);
+
+        warmup->total_time += test_time;
+        warmup->wall_time += duration;
+        warmup->tests_cnt++;
+        warmup->iterations_cnt += benchmark()->iterations;
+
+        window[window_cnt % STEADY_STATE_WINDOW] = (double) test_time / (double) benchmark()->iterations;
+        window_cnt++;
+
+        if (window_cnt >= STEADY_STATE_WINDOW) {
+            // Oldest sample first, the segments are consecutive in time.
+            for (size_t i = 0; i < STEADY_STATE_WINDOW; i++) {
+                scratch[i] = window[(window_cnt + i) % STEADY_STATE_WINDOW];
+            }
+
+            bool steady = segment_drift(scratch, STEADY_STATE_WINDOW, STEADY_STATE_SEGMENTS) <= config->tolerance;
+
+            // The stream has to stay steady until the minimum time, a new drift starts the count over.
+            if (steady && !results->stabilized) {
+                results->stabilized = true;
+                results->stable_tests = warmup->tests_cnt;
+                results->stable_iterations = warmup->iterations_cnt;
+            }
+            else if (!steady) {
+                results->stabilized = false;
+                results->stable_tests = 0;
+                results->stable_iterations = 0;
+            }
+        }
+
+        if (results->stabilized && warmup->wall_time >= warmup->set_time) {
+            break;
+        }
+    }
+}
+
 static void begin_testing() {
     test_t begin_tests = {};
     initialize_test_info(&begin_tests, BEGIN);
@@ -159,12 +1859,13 @@ static void begin_testing() {
     double average = 0;
     double relative_deviation = 0;
     size_t begin_cnt = begin_tests.set_iterations;
-    clock_t begin_time = 0;
-    clock_t test_time = 0;
+    ticks_t begin_time = 0;
+    ticks_t test_time = 0;
 
     for (size_t i = 0; i < begin_cnt; i++) {
         test_time = run_test(BEGIN);
         begin_time += test_time;
+        push_sample(test_time);
     }
 
     begin_tests.total_time = begin_time;
@@ -173,9 +1874,10 @@ static void begin_testing() {
     while (begin_tests.tests_cnt++ < begin_tests.set_iterations + begin_cnt) {
         test_time = run_test(BEGIN);
         begin_tests.total_time += test_time;
+        push_sample(test_time);
 
         average = ((double) begin_tests.total_time) / begin_tests.tests_cnt;
-        relative_deviation = fabs(test_time - average) / average;
+        relative_deviation = fabs((double) test_time - average) / average;
         group_deviation_push(&relative_deviation, BEGIN);
     }
 
@@ -184,32 +1886,187 @@ static void begin_testing() {
 }
 
 static void run_testing() {
+    samples_dtor(&benchmark()->samples);
+    if (!samples_ctor(&benchmark()->samples, benchmark()->max_samples, measurement_arena())) {
+        return;
+    }
+
+    histogram_reset(&benchmark()->histogram);
     group_deviation_ctor();
 
+    if (benchmark()->threads > 1) {
+        thread_pool_reset_totals(thread_pool());
+    }
+
+    perf_counters_reset(perf_counters());
+    reset_processed(benchmark());
+
+    if (benchmark()->track_allocations) {
+        alloc_tracking_reset();
+    }
+
+    if (benchmark()->async_samples) {
+        sample_stream_start();
+    }
+
     begin_testing();
+    precision_reset();
 
     test_t main_tests = {};
     initialize_test_info(&main_tests, KEEP);
 
-    double epsilon = benchmark()->epsilon;
     double relative_deviation = 0;
     double average = 0;
-    clock_t max_test_time = benchmark()->max_test_time;
-    clock_t test_time = 0;
+    ticks_t max_test_time = timer_ns_to_ticks(benchmark()->max_test_time);
+    ticks_t test_time = 0;
+
+    ticks_t wall_time = 0;
 
     do {
-        test_time = run_test(main_tests.state);
+        test_time = run_test(main_tests.state, &wall_time);
         main_tests.total_time += test_time;
+        main_tests.wall_time += wall_time;
+        main_tests.clamped_cnt += test_time == 0 && wall_time > 0;
         main_tests.tests_cnt++;
+        precision_push(push_sample(test_time));
 
         average = (double) main_tests.total_time / main_tests.tests_cnt;
-        relative_deviation = fabs(test_time - average) / average;
+        relative_deviation = fabs((double) test_time - average) / average;
         group_deviation_push(&relative_deviation, KEEP);
-    } while (group_deviation()->average > epsilon && main_tests.total_time < max_test_time);
+    } while (keep_testing(&main_tests, max_test_time));
 
+    sample_stream_stop();
     set_testing_results(&main_tests);
 
     group_deviation_dtor();
+    samples_dtor(&precision_tracker()->scratch);
+}
+
+static double push_sample(ticks_t test_time) {
+    double sample = (double) test_time / (double) benchmark()->iterations;
+    if (benchmark()->subtract_baseline) {
+        sample = fmax(sample - iteration_baseline(), 0);
+    }
+
+    if (!sample_stream()->running) {
+        record_sample(sample);
+        return sample;
+    }
+
+    while (!spsc_ring_push(&sample_stream()->ring, &sample)) {
+        sched_yield();
+    }
+
+    return sample;
+}
+
+static void record_sample(double sample) {
+    samples_push(&benchmark()->samples, sample);
+    histogram_record(&benchmark()->histogram, sample);
+}
+
+//============================================================================================================
+
+static sample_stream_t* sample_stream() {
+    static sample_stream_t sample_stream = {};
+    return &sample_stream;
+}
+
+// Without a thread the samples are recorded inline, as if the stream was never asked for.
+static void sample_stream_start() {
+    sample_stream_t* stream = sample_stream();
+
+    if (spsc_ring_ctor(&stream->ring, SAMPLE_STREAM_CAPACITY, sizeof(double), measurement_arena()) != NO_ERRORS) {
+        return;
+    }
+
+    stream->stop.store(false, std::memory_order_relaxed);
+
+    int error = pthread_create(&stream->thread, nullptr, sample_stream_consume, nullptr);
+    if (error) {
+        LOG(WARNING, "Can't start the sample thread, samples are recorded inline: %s\n", strerror(error));
+        spsc_ring_dtor(&stream->ring);
+        return;
+    }
+
+    stream->running = true;
+}
+
+static void sample_stream_stop() {
+    sample_stream_t* stream = sample_stream();
+
+    if (!stream->running) {
+        return;
+    }
+
+    stream->stop.store(true, std::memory_order_release);
+    pthread_join(stream->thread, nullptr);
+
+    spsc_ring_dtor(&stream->ring);
+    stream->running = false;
+}
+
+// Sleeps while the ring is empty instead of spinning, so that it doesn't compete with the measured
+// thread for a core. The ring holds far more samples than arrive during one sleep.
+static void* sample_stream_consume(void*) {
+    sample_stream_t* stream = sample_stream();
+    const struct timespec idle = {0, SAMPLE_STREAM_IDLE_NS};
+    double sample = 0;
+
+    while (true) {
+        if (spsc_ring_pop(&stream->ring, &sample)) {
+            record_sample(sample);
+            continue;
+        }
+
+        if (stream->stop.load(std::memory_order_acquire)) {
+            while (spsc_ring_pop(&stream->ring, &sample)) {
+                record_sample(sample);
+            }
+            return nullptr;
+        }
+
+        nanosleep(&idle, nullptr);
+    }
+}
+
+//============================================================================================================
+
+static arena_t* arena() {
+    static arena_t arena = {};
+    return &arena;
+}
+
+// nullptr when the arena couldn't be mapped, the containers fall back to the heap then.
+static arena_t* measurement_arena() {
+    return arena()->base ? arena() : nullptr;
+}
+
+// The sample buffer and the rings of the testing phase are carved out of one mapping that is written
+// to before the warmup, so that recording samples takes neither page faults nor malloc calls. Ring
+// capacities are rounded up to powers of two, hence the doubled sizes.
+static void prepare_arena() {
+    size_t scratch = benchmark()->precision.target > 0 && benchmark()->precision.statistic == PRECISION_MEDIAN;
+
+    size_t size = (1 + scratch) * benchmark()->max_samples * sizeof(double) +
+                  2 * CONTROL_GROUP_SIZE * sizeof(double) +
+                  2 * SAMPLE_STREAM_CAPACITY * sizeof(double) + ARENA_SLACK;
+
+    if (arena_ctor(arena(), size, benchmark()->huge_pages)) {
+        arena_prefault(arena());
+    }
+}
+
+// The retained samples move to a heap buffer of their actual size before the mapping goes away.
+static void release_arena() {
+    if (!arena()->base) {
+        return;
+    }
+
+    samples_t retained(benchmark()->samples);
+    benchmark()->samples.swap(retained);
+
+    arena_dtor(arena());
 }
 
 //============================================================================================================
@@ -223,14 +2080,14 @@ static void group_deviation_ctor() {
     group_deviation()->average = 0;
     group_deviation()->length = 0;
 
-    cb_ctor(&group_deviation()->buffer, CONTROL_GROUP_SIZE, sizeof(double));
+    spsc_ring_ctor(&group_deviation()->buffer, CONTROL_GROUP_SIZE, sizeof(double), measurement_arena());
 }
 
 static void group_deviation_dtor() {
     group_deviation()->average = 0;
     group_deviation()->length  = 0;
 
-    cb_dtor(&group_deviation()->buffer);
+    spsc_ring_dtor(&group_deviation()->buffer);
 }
 
 static void group_deviation_push(double* elm, state_t state) {
@@ -238,7 +2095,7 @@ static void group_deviation_push(double* elm, state_t state) {
     size_t length = group_deviation()->length;
 
     if (state == BEGIN) {
-        cb_push(&group_deviation()->buffer, elm);
+        spsc_ring_push(&group_deviation()->buffer, elm);
 
         group_deviation()->average = (group_deviation()->average * length + *elm) / (length + 1);
 
@@ -247,8 +2104,8 @@ static void group_deviation_push(double* elm, state_t state) {
     else if (state == KEEP) {
         double popped_elm = 0;
 
-        cb_pop(&group_deviation()->buffer, &popped_elm);
-        cb_push(&group_deviation()->buffer, elm);
+        spsc_ring_pop(&group_deviation()->buffer, &popped_elm);
+        spsc_ring_push(&group_deviation()->buffer, elm);
 
         group_deviation()->average = ((group_deviation()->average * length) - popped_elm + *elm) / length;
     }
@@ -256,27 +2113,174 @@ static void group_deviation_push(double* elm, state_t state) {
 
 //============================================================================================================
 
-void print_report() {
-    fprintf(stdout, "\n-------------Testing results--------------\n\n");
+static precision_tracker_t* precision_tracker() {
+    static precision_tracker_t precision_tracker;
+    return &precision_tracker;
+}
+
+static void precision_reset() {
+    precision_tracker_t* tracker = precision_tracker();
+    const precision_config_t* config = &benchmark()->precision;
+
+    tracker->count = 0;
+    tracker->mean = 0;
+    tracker->m2 = 0;
+    tracker->next_check = 0;
+    tracker->first_sample = benchmark()->samples.size;
+    tracker->results = {};
+
+    samples_dtor(&tracker->scratch);
+    if (config->target > 0 && config->statistic == PRECISION_MEDIAN) {
+        samples_ctor(&tracker->scratch, benchmark()->max_samples, measurement_arena());
+    }
+}
+
+static void precision_push(double sample) {
+    precision_tracker_t* tracker = precision_tracker();
+
+    tracker->count++;
+
+    double delta = sample - tracker->mean;
+    tracker->mean += delta / (double) tracker->count;
+    tracker->m2 += delta * (sample - tracker->mean);
+}
+
+// The interval is recomputed every PRECISION_CHECK_INTERVAL samples, or once their count has grown by
+// 1/PRECISION_CHECK_DIVISOR. The median interval copies the samples on every check, so its checks are spaced
+// by 1/PRECISION_MEDIAN_CHECK_DIVISOR, which bounds the copies to a few passes over the final samples.
+static bool precision_reached() {
+    precision_tracker_t* tracker = precision_tracker();
+    const precision_config_t* config = &benchmark()->precision;
+    size_t count = tracker->count;
+
+    if (count < config->min_samples || count < PRECISION_MIN_SAMPLES) {
+        return false;
+    }
+
+    if (config->max_samples && count >= config->max_samples) {
+        return true;
+    }
+
+    if (count >= tracker->next_check) {
+        bool median = config->statistic == PRECISION_MEDIAN;
+        size_t step = count / (median ? PRECISION_MEDIAN_CHECK_DIVISOR : PRECISION_CHECK_DIVISOR);
+        tracker->next_check = count + (step > PRECISION_CHECK_INTERVAL ? step : PRECISION_CHECK_INTERVAL);
+
+        precision_update();
+    }
+
+    return tracker->results.reached;
+}
+
+static void precision_update() {
+    precision_tracker_t* tracker = precision_tracker();
+    const precision_config_t* config = &benchmark()->precision;
+    precision_results_t* results = &tracker->results;
+
+    results->measured = tracker->count > 1;
+    results->samples = tracker->count;
 
-    fprintf(stdout, "\t[Testing time]: %f\n\t[Tests amount]: %zu\n"
-                    "\t[Test avarage time]: %f\n\t[Avarage relative deviation]: = %2.2f%%\n\n",
-                    (double) benchmark()->testing_results.time / CLOCKS_PER_SEC,
-                    benchmark()->testing_results.tests_cnt,
-                    benchmark()->testing_results.average_time,
-                    benchmark()->testing_results.average_relative_deviation * 100);
+    if (!results->measured) {
+        return;
+    }
+
+    const samples_t* samples = &benchmark()->samples;
+    size_t kept = samples->size > tracker->first_sample ? samples->size - tracker->first_sample : 0;
+    bool median = config->statistic == PRECISION_MEDIAN;
+
+    if (median && (!kept || tracker->scratch.capacity < kept)) {
+        static bool warned = false;
+
+        if (!warned) {
+            LOG(WARNING, "The samples of \"%s\" aren't available for the median interval, using the mean\n",
+                         benchmark()->name);
+            warned = true;
+        }
+        median = false;
+    }
+
+    if (median) {
+        samples_t* scratch = &tracker->scratch;
+        double low = 0;
+        double high = 0;
+
+        scratch->clear();
+        scratch->append(samples->data + tracker->first_sample, kept);
 
-    fprintf(stdout, "----------------Warmup-------------------\n\n");
-    fprintf(stdout, "\t[Warmup time]: %f\n\t[Warmup tests amount]: %zu\n",
-                    (double) benchmark()->warmup_results.time / CLOCKS_PER_SEC,
-                    benchmark()->warmup_results.tests_cnt);
+        results->estimate = select_kth(scratch->data, scratch->size, scratch->size / 2);
+        median_confidence_interval(scratch->data, scratch->size, config->confidence, &low, &high);
+        results->half_width = (high - low) / 2;
+    }
+    else {
+        double count = (double) tracker->count;
+        double stddev = sqrt(tracker->m2 / (count - 1));
+
+        results->estimate = tracker->mean;
+        results->half_width = student_t_quantile((1 + config->confidence) / 2, count - 1) * stddev / sqrt(count);
+    }
 
-    fprintf(stdout, "\n----------------------------------------\n");
+    results->relative = results->estimate > 0 ? results->half_width / results->estimate : INFINITY;
+    results->reached = results->relative <= config->target;
 }
 
+// With a target precision the confidence interval decides when to stop, otherwise the sliding average of
+// the relative deviations does. max_test_time bounds both.
+static bool keep_testing(const test_t* main_tests, ticks_t max_test_time) {
+    if (main_tests->wall_time >= max_test_time) {
+        return false;
+    }
+
+    if (benchmark()->precision.target > 0) {
+        return !precision_reached();
+    }
+
+    return group_deviation()->average > benchmark()->epsilon;
+}
 
 //============================================================================================================
 
 static bool compare_doubles(double a, double b) {
     return fabs(a - b) < EPSILON_DOUBLE;
 }
+
+static int compare_ticks(const void* a, const void* b) {
+    ticks_t lhs = *(const ticks_t*) a;
+    ticks_t rhs = *(const ticks_t*) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int compare_sample_doubles(const void* a, const void* b) {
+    double lhs = *(const double*) a;
+    double rhs = *(const double*) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int compare_sizes(const void* a, const void* b) {
+    size_t lhs = *(const size_t*) a;
+    size_t rhs = *(const size_t*) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static const char* option_value(const char* arg, const char* option) {
+    size_t option_len = strlen(option);
+
+    if (strncmp(arg, option, option_len) || arg[option_len] != '=') {
+        return nullptr;
+    }
+
+    return arg + option_len + 1;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--filter=REGEX] [--list] [--format=console|json|csv] [--out=FILE]\n"
+                    "       [--subtract-baseline] [--check-environment] [--pin-cpu=CPU] [--raise-priority]\n"
+                    "       [--perf-counters] [--track-allocations] [--repetitions=N] [--async-samples]\n"
+                    "       [--huge-pages] [--async-log] [--precision=FRACTION] [--confidence=LEVEL]\n"
+                    "       [--precision-statistic=mean|median] [--min-samples=N] [--max-samples=N]\n"
+                    "       [--steady-warmup] [--max-warmup-time=SECONDS]\n"
+                    "       [--save-baseline=FILE] [--compare=FILE]\n"
+                    "       [--compare-test=welch|mann-whitney] [--alpha=P] [--threshold=FRACTION]\n", program);
+}
@@ -1,14 +1,40 @@
 #ifndef BENCHMARK_H
 #define BENCHMARK_H
 
-#include <time.h>
+#include <string.h>
 
 #include "queue.h"
+#include "alloc_tracker.h"
+#include "arena.h"
+#include "complexity.h"
+#include "environment.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "stats.h"
+#include "thread_pool.h"
+#include "timer.h"
 
-#define BENCHMARK(func) benchmark_func(func)
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_UNIQUE_(counter) BENCHMARK_CONCAT_(benchmark_registered_, counter)
+
+#define BENCHMARK(func) \
+    static benchmark_t* BENCHMARK_UNIQUE_(__COUNTER__) __attribute__((unused)) = benchmark_register(#func, func)
+
+#define BENCHMARK_APPLY(func, apply)                                                 \
+    static benchmark_t* BENCHMARK_UNIQUE_(__COUNTER__) __attribute__((unused)) =     \
+        benchmark_apply(benchmark_register(#func, func), apply)
+
+#define BENCHMARK_MAIN()                      \
+    int main(int argc, char* argv[]) {        \
+        return benchmark_main(argc, argv);    \
+    }
 
 #define DoNotOptimize(value) asm volatile("" : "+m"(value) : : "memory")
 
+#define BENCHMARK_MAX_ARGS 4
+#define BENCHMARK_MAX_NAME_LEN 128
+#define BENCHMARK_MAX_COUNTERS 8
+
 typedef enum {
     STOP   = 0,
     WARMUP = 1,
@@ -17,55 +43,380 @@ typedef enum {
 } state_t;
 
 typedef struct {
-    clock_t time;
+    ticks_t time;
     size_t tests_cnt;
 } results_t;
 
+typedef enum {
+    USER_COUNTER_AVERAGE = 0,   // per iteration
+    USER_COUNTER_SUM     = 1,   // over the whole testing phase
+    USER_COUNTER_RATE    = 2,   // per second
+} user_counter_kind_t;
+
+typedef struct {
+    const char* name;
+    user_counter_kind_t kind;
+    double value;
+} user_counter_t;
+
+typedef struct {
+    state_t state;
+    size_t iterations;
+
+    const int64_t* args;
+    size_t args_cnt;
+    int64_t complexity_n;
+
+    size_t thread_index;
+    size_t threads;
+    void* data;
+
+    int64_t bytes_processed;
+    int64_t items_processed;
+    user_counter_t counters[BENCHMARK_MAX_COUNTERS];
+    size_t counters_cnt;
+
+    bool tracking_allocations;
+    const perf_counters_t* perf_counters;   // counting the timed region of this thread, or null
+    ticks_t pause_start;
+    ticks_t paused_time;
+    size_t pauses_cnt;
+} context_t;
+
+typedef struct {
+    int64_t args[BENCHMARK_MAX_ARGS];
+    size_t args_cnt;
+} arg_point_t;
+
+typedef struct {
+    int64_t start;
+    int64_t limit;
+    int64_t multiplier;
+} range_t;
+
 typedef void (*test_func_t) (state_t state);
+typedef void (*context_func_t) (context_t* ctx);
+typedef void (*fixture_func_t) (context_t* ctx);
+
+// Time between the two calls is left out of the sample, together with the calibrated cost of the
+// pair itself. Allocations made while paused are not tracked either.
+inline void pause_timing(context_t* ctx) {
+    ctx->pause_start = timer_stop();
+
+    if (ctx->perf_counters) {
+        perf_counters_disable(ctx->perf_counters);
+    }
+
+    if (ctx->tracking_allocations) {
+        alloc_tracking_end();
+    }
+}
+
+inline void resume_timing(context_t* ctx) {
+    if (ctx->tracking_allocations) {
+        alloc_tracking_begin();
+    }
+
+    if (ctx->perf_counters) {
+        perf_counters_enable(ctx->perf_counters);
+    }
+
+    ctx->paused_time += timer_start() - ctx->pause_start;
+    ctx->pauses_cnt++;
+}
+
+// Adds value to the named counter of the current sample; name must outlive the benchmark run.
+inline void benchmark_counter(context_t* ctx, const char* name, double value,
+                              user_counter_kind_t kind = USER_COUNTER_AVERAGE) {
+    for (size_t i = 0; i < ctx->counters_cnt; i++) {
+        if (ctx->counters[i].name == name || !strcmp(ctx->counters[i].name, name)) {
+            ctx->counters[i].value += value;
+            return;
+        }
+    }
+
+    if (ctx->counters_cnt < BENCHMARK_MAX_COUNTERS) {
+        ctx->counters[ctx->counters_cnt++] = {name, kind, value};
+    }
+}
+
+typedef struct {
+    bool measured;
+    double allocations;       // per iteration
+    double frees;             // per iteration
+    double bytes;             // allocated per iteration
+    int64_t peak_live_bytes;
+} allocations_results_t;
+
+// Steady-state warmup: past min_warmup_time, warmup ends as soon as the last samples stop drifting.
+typedef struct {
+    bool steady_state;
+    uint64_t max_time;      // ns, hard bound of a steady-state warmup
+    double tolerance;       // largest relative spread of the medians over the detection window
+} warmup_config_t;
+
+typedef struct {
+    ticks_t time;           // wall time, pauses included; it is what the warmup time bounds
+    size_t tests_cnt;
+
+    bool steady_state;      // detection was on
+    bool stabilized;
+    size_t stable_tests;    // warmup tests and iterations run until the window settled
+    size_t stable_iterations;
+} warmup_results_t;
+
+typedef enum {
+    PRECISION_MEAN   = 0,   // Student's t interval
+    PRECISION_MEDIAN = 1,   // distribution-free interval from order statistics
+} precision_statistic_t;
+
+// Sequential stopping rule: testing goes on until the confidence interval of the statistic is narrow enough.
+typedef struct {
+    double target;          // relative half-width of the interval; 0 keeps the epsilon rule
+    double confidence;
+    precision_statistic_t statistic;
+    size_t min_samples;
+    size_t max_samples;     // 0: only max_test_time bounds the run
+} precision_config_t;
+
+typedef struct {
+    bool measured;
+    double estimate;        // mean or median per iteration
+    double half_width;
+    double relative;        // half_width / estimate
+    bool reached;
+    size_t samples;
+} precision_results_t;
+
+typedef struct {
+    size_t repetitions;  // completed
+    double mean;         // of the average times of the repetitions
+    double median;
+    double stddev;
+    double min;
+    double max;
+} repetitions_results_t;
 
 typedef struct {
-    clock_t time;
+    ticks_t time;
     size_t tests_cnt;
+    size_t iterations;
     double average_time;
     double average_relative_deviation;
+    double baseline;
+    bool baseline_subtracted;
+    double timer_overhead;
+    double pause_overhead;
+    size_t clamped_samples;  // whose paused time and pause overhead took up the whole sample
+
+    size_t threads;
+    double thread_time_min;  // per iteration
+    double thread_time_max;  // per iteration
+    double throughput;       // iterations per second, all threads together
+    double speedup;          // throughput relative to the smallest thread count of the family
+    double efficiency;       // speedup per added thread
+
+    double bytes_per_second;
+    double items_per_second;
+    user_counter_t user_counters[BENCHMARK_MAX_COUNTERS];
+    size_t user_counters_cnt;
+
+    repetitions_results_t repetitions;
+    precision_results_t precision;
+
+    counters_results_t counters;
+    allocations_results_t allocations;
+    statistics_t stats;
 } testing_results_t;
 
-typedef struct {
-    clock_t min_warmup_time;
-    clock_t max_test_time;
+typedef struct benchmark_t {
+    const char* name;
+
+    uint64_t min_warmup_time; // ns
+    warmup_config_t warmup;
+    uint64_t max_test_time;   // ns
+
+    uint64_t sample_time;     // ns
+    timer_backend_t timer;
+    double ns_per_tick;
 
     size_t iterations;
     double epsilon;
+    precision_config_t precision;
+    bool subtract_baseline;
+    size_t max_samples;
 
     test_func_t func;
+    context_func_t context_func;
+
+    fixture_func_t setup;
+    fixture_func_t teardown;
+    fixture_func_t iteration_setup;
+    fixture_func_t iteration_teardown;
+    void* fixture_data;
+
+    int64_t bytes_per_iteration;
+    int64_t items_per_iteration;
+    double bytes_processed;
+    double items_processed;
+    user_counter_t counter_totals[BENCHMARK_MAX_COUNTERS];
+    size_t counter_totals_cnt;
 
-    results_t warmup_results;
+    int64_t args[BENCHMARK_MAX_ARGS];
+    size_t args_cnt;
+    int64_t complexity_n;
+    char instance_name[BENCHMARK_MAX_NAME_LEN];
+
+    size_t threads;
+    environment_config_t environment_config;
+    bool perf_counters;
+    bool track_allocations;
+    bool async_samples;
+    bool huge_pages;
+    size_t repetitions;
+    double* repetition_times;
+
+    arg_point_t* points;
+    size_t points_cnt;
+    size_t* thread_counts;
+    size_t thread_counts_cnt;
+    bool expanded;
+    complexity_t complexity;
+    complexity_fit_t complexity_fit;
+    struct benchmark_t* family;
+
+    warmup_results_t warmup_results;
     results_t begin_results;
     testing_results_t testing_results;
+    samples_t samples;
+    histogram_t histogram;
+    environment_t environment;
+
+    struct benchmark_t* next;
 } benchmark_t;
 
+typedef void (*apply_func_t) (benchmark_t* bm);
+
+typedef struct {
+    benchmark_t* head;
+    benchmark_t* tail;
+    benchmark_t* current;
+    size_t size;
+} registry_t;
+
 typedef struct {
     state_t state;
     size_t tests_cnt;
-    clock_t total_time;
+    ticks_t total_time;
+    ticks_t wall_time;  // total_time with the paused parts of the samples
+    size_t iterations_cnt;
+    size_t clamped_cnt; // samples that came out at 0 after the pauses were subtracted
 
-    clock_t set_time;
-    clock_t set_iterations;
+    ticks_t set_time;
+    size_t set_iterations;
 } test_t;
 
 typedef struct {
-    circ_buffer_t buffer;
+    bool calibrated;
+    timer_backend_t timer;
+    double sample_overhead; // ticks per test
+    double call_overhead;   // ticks per test_func_t call
+    double pause_overhead;  // ticks per pause_timing() / resume_timing() pair
+} overhead_t;
+
+typedef struct {
+    benchmark_t* bm;
+    state_t state;
+    ticks_t wall_time;  // of the timed region of thread 0, pauses included
+    ticks_t max_paused; // longest paused part over the threads of the last sample
+} thread_batch_t;
+
+// What a repetition process sends back, followed by its samples and its histogram.
+typedef struct {
+    warmup_results_t warmup_results;
+    results_t begin_results;
+    testing_results_t testing_results;
+    environment_t environment;
+
+    size_t iterations;
+    timer_backend_t timer;
+    double ns_per_tick;
+    int64_t complexity_n;
+    size_t samples_cnt;
+} repetition_message_t;
+
+typedef struct {
+    spsc_ring_t buffer;
     double average;
     size_t length;
 } group_deviation_t;
 
+// Running state of the stopping rule over the samples taken after the control group.
+typedef struct {
+    size_t count;
+    double mean;
+    double m2;              // sum of squared deviations from the mean (Welford)
+    size_t next_check;
+    size_t first_sample;    // index of the first tracked sample in benchmark()->samples
+    samples_t scratch;      // for the median interval
+    precision_results_t results;
+} precision_tracker_t;
+
+// Testing samples handed from the measuring thread to a statistics thread.
+typedef struct {
+    spsc_ring_t ring;
+    pthread_t thread;
+    std::atomic<bool> stop;
+    bool running;
+} sample_stream_t;
+
 benchmark_t* benchmark();
 void run_benchmark();
 void benchmark_func(test_func_t test_func);
 
+registry_t* registry();
+benchmark_t* benchmark_register(const char* name, test_func_t test_func);
+benchmark_t* benchmark_register(const char* name, context_func_t context_func);
+benchmark_t* benchmark_select(const char* name);
+benchmark_t* benchmark_apply(benchmark_t* bm, apply_func_t apply);
+size_t run_benchmarks(const char* filter);
+int benchmark_main(int argc, char* argv[]);
+
 void set_min_warmup_time(double seconds);
+void set_steady_state_warmup(bool steady, double tolerance = 0.02);
+void set_max_warmup_time(double seconds);
 void set_epsilon(double epsilon);
+void set_target_precision(double relative, double confidence = 0.95);
+void set_precision_statistic(precision_statistic_t statistic);
+void set_sample_count_bounds(size_t min_samples, size_t max_samples);
 void set_max_testing_time(double seconds);
+void set_sample_time(double seconds);
+void set_timer(timer_backend_t backend);
+void set_subtract_baseline(bool subtract);
+void set_max_samples(size_t max_samples);
+void set_complexity(complexity_t complexity);
+void set_threads(size_t threads);
+void set_check_environment(bool check);
+void set_pin_cpu(int cpu);
+void set_raise_priority(bool raise);
+void set_perf_counters(bool enable);
+void set_track_allocations(bool track);
+void set_async_samples(bool async);
+void set_huge_pages(bool huge_pages);
+void set_fixture(fixture_func_t setup, fixture_func_t teardown);
+void set_iteration_fixture(fixture_func_t setup, fixture_func_t teardown);
+void set_bytes_per_iteration(int64_t bytes);
+void set_items_per_iteration(int64_t items);
+void set_repetitions(size_t repetitions);
+
+void benchmark_arg(int64_t arg);
+void benchmark_args(const int64_t* args, size_t args_cnt);
+void benchmark_range(int64_t start, int64_t limit, int64_t multiplier);
+void benchmark_dense_range(int64_t start, int64_t limit, int64_t step);
+void benchmark_ranges(const range_t* ranges, size_t ranges_cnt);
+void benchmark_threads(size_t threads);
+void benchmark_thread_range(size_t min_threads, size_t max_threads);
+void benchmark_threads_sweep();
 void print_report();
 
 #endif /* BENCHMARK_H */
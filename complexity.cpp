@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <math.h>
+
+#include "complexity.h"
+
+static double complexity_curve(complexity_t complexity, double n);
+static complexity_fit_t fit_curve(const int64_t* n, const double* time, size_t points_cnt, complexity_t complexity);
+
+//============================================================================================================
+
+// Least squares fit of time = coefficient * g(n) for the requested g, or for every g with
+// COMPLEXITY_AUTO, keeping the curve with the smallest RMS error relative to the mean time.
+complexity_fit_t fit_complexity(const int64_t* n, const double* time, size_t points_cnt, complexity_t complexity) {
+    assert(n);
+    assert(time);
+
+    complexity_fit_t best = {COMPLEXITY_NONE, 0, 0, points_cnt};
+
+    if (complexity == COMPLEXITY_NONE || points_cnt < 2) {
+        return best;
+    }
+
+    if (complexity != COMPLEXITY_AUTO) {
+        return fit_curve(n, time, points_cnt, complexity);
+    }
+
+    for (int curve = O_1; curve < COMPLEXITY_AUTO; curve++) {
+        complexity_fit_t fit = fit_curve(n, time, points_cnt, (complexity_t) curve);
+
+        if (best.complexity == COMPLEXITY_NONE || fit.rms < best.rms) {
+            best = fit;
+        }
+    }
+
+    return best;
+}
+
+const char* complexity_name(complexity_t complexity) {
+    switch (complexity) {
+        case COMPLEXITY_NONE:
+            return "none";
+        case O_1:
+            return "O(1)";
+        case O_LOG_N:
+            return "O(log n)";
+        case O_N:
+            return "O(n)";
+        case O_N_LOG_N:
+            return "O(n log n)";
+        case O_N_SQUARED:
+            return "O(n^2)";
+        case O_N_CUBED:
+            return "O(n^3)";
+        case COMPLEXITY_AUTO:
+            return "auto";
+        default:
+            assert(0 && "Undefined complexity");
+            return "unknown";
+    }
+}
+
+//============================================================================================================
+
+// Ranges often start at 0; log2 is taken of at least 1 there, so such points add 0 instead of -inf or NaN.
+static double complexity_curve(complexity_t complexity, double n) {
+    switch (complexity) {
+        case O_1:
+            return 1;
+        case O_LOG_N:
+            return log2(fmax(n, 1));
+        case O_N:
+            return n;
+        case O_N_LOG_N:
+            return n * log2(fmax(n, 1));
+        case O_N_SQUARED:
+            return n * n;
+        case O_N_CUBED:
+            return n * n * n;
+        default:
+            assert(0 && "Not a complexity curve");
+            return 1;
+    }
+}
+
+static complexity_fit_t fit_curve(const int64_t* n, const double* time, size_t points_cnt, complexity_t complexity) {
+    complexity_fit_t fit = {complexity, 0, 0, points_cnt};
+
+    double time_curve = 0;
+    double curve_squares = 0;
+    double time_sum = 0;
+
+    for (size_t i = 0; i < points_cnt; i++) {
+        double curve = complexity_curve(complexity, (double) n[i]);
+
+        time_curve += time[i] * curve;
+        curve_squares += curve * curve;
+        time_sum += time[i];
+    }
+
+    fit.coefficient = curve_squares > 0 ? time_curve / curve_squares : 0;
+
+    double residuals = 0;
+    for (size_t i = 0; i < points_cnt; i++) {
+        double residual = time[i] - fit.coefficient * complexity_curve(complexity, (double) n[i]);
+        residuals += residual * residual;
+    }
+
+    double mean = time_sum / (double) points_cnt;
+    fit.rms = mean > 0 ? sqrt(residuals / (double) points_cnt) / mean : 0;
+
+    return fit;
+}
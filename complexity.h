@@ -0,0 +1,28 @@
+#ifndef COMPLEXITY_H
+#define COMPLEXITY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef enum {
+    COMPLEXITY_NONE = 0,
+    O_1             = 1,
+    O_LOG_N         = 2,
+    O_N             = 3,
+    O_N_LOG_N       = 4,
+    O_N_SQUARED     = 5,
+    O_N_CUBED       = 6,
+    COMPLEXITY_AUTO = 7,
+} complexity_t;
+
+typedef struct {
+    complexity_t complexity;
+    double coefficient;
+    double rms;         // relative to the mean time
+    size_t points_cnt;
+} complexity_fit_t;
+
+complexity_fit_t fit_complexity(const int64_t* n, const double* time, size_t points_cnt, complexity_t complexity);
+const char* complexity_name(complexity_t complexity);
+
+#endif /* COMPLEXITY_H */
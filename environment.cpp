@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/resource.h>
+
+#include "environment.h"
+#include "logger.h"
+
+static environment_state_t* saved_state();
+static void pin_cpu(const environment_config_t* config, environment_t* env);
+static void raise_priority(environment_t* env);
+static void read_cpu_info(environment_t* env);
+static bool read_sysfs_str(const char* path, char* str, size_t size);
+static long read_sysfs_long(const char* path);
+
+//============================================================================================================
+
+const int HIGHEST_NICE = -20;
+const char* const SYSFS_CPU = "/sys/devices/system/cpu";
+const char* const PERFORMANCE_GOVERNOR = "performance";
+
+//============================================================================================================
+
+// Runs before the warmup: pins the calling thread and raises its priority if requested, then records
+// where it runs and the conditions of that CPU which make timings drift between runs. Both settings are
+// per thread: workers of a thread pool started before this call keep the affinity and nice value of the process.
+void environment_setup(const environment_config_t* config, environment_t* env) {
+    assert(config);
+    assert(env);
+
+    memset(env, 0, sizeof(environment_t));
+
+    if (!config->enabled) {
+        return;
+    }
+
+    env->checked = true;
+    env->turbo = -1;
+
+    if (config->pin) {
+        pin_cpu(config, env);
+    }
+    else {
+        env->warnings |= ENV_WARNING_NOT_PINNED;
+    }
+
+    if (config->raise_priority) {
+        raise_priority(env);
+    }
+
+    env->nice = getpriority(PRIO_PROCESS, 0);
+
+    if (!env->pinned) {
+        env->cpu = sched_getcpu();
+    }
+
+    read_cpu_info(env);
+
+    if (env->governor[0] && strcmp(env->governor, PERFORMANCE_GOVERNOR)) {
+        env->warnings |= ENV_WARNING_GOVERNOR;
+    }
+
+    if (env->turbo == 1) {
+        env->warnings |= ENV_WARNING_TURBO;
+    }
+
+    if (strpbrk(env->smt_siblings, ",-")) {
+        env->warnings |= ENV_WARNING_SMT;
+    }
+}
+
+// Gives back the affinity and priority the thread had before environment_setup().
+void environment_restore() {
+    environment_state_t* saved = saved_state();
+
+    if (saved->affinity_saved && sched_setaffinity(0, sizeof(cpu_set_t), &saved->affinity)) {
+        LOG(WARNING, "Can't restore CPU affinity: %s\n", strerror(errno));
+    }
+
+    if (saved->nice_saved && setpriority(PRIO_PROCESS, 0, saved->nice)) {
+        LOG(WARNING, "Can't restore scheduling priority: %s\n", strerror(errno));
+    }
+
+    saved->affinity_saved = false;
+    saved->nice_saved = false;
+}
+
+const char* environment_warning_name(environment_warning_t warning) {
+    switch (warning) {
+        case ENV_WARNING_PIN_FAILED:
+            return "CPU pinning failed";
+        case ENV_WARNING_NOT_PINNED:
+            return "benchmark thread is not pinned and may migrate between CPUs";
+        case ENV_WARNING_PRIORITY:
+            return "scheduling priority could not be raised";
+        case ENV_WARNING_GOVERNOR:
+            return "cpufreq governor is not \"performance\"";
+        case ENV_WARNING_TURBO:
+            return "turbo boost is enabled";
+        case ENV_WARNING_SMT:
+            return "SMT sibling shares the core";
+        default:
+            assert(0 && "Undefined environment warning");
+            return "unknown";
+    }
+}
+
+//============================================================================================================
+
+static environment_state_t* saved_state() {
+    static environment_state_t state = {};
+    return &state;
+}
+
+static void pin_cpu(const environment_config_t* config, environment_t* env) {
+    environment_state_t* saved = saved_state();
+
+    if (!saved->affinity_saved) {
+        saved->affinity_saved = !sched_getaffinity(0, sizeof(cpu_set_t), &saved->affinity);
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    if (config->cpu < 0 || config->cpu >= CPU_SETSIZE) {
+        LOG(WARNING, "Can't pin benchmark thread to CPU %d: no such CPU\n", config->cpu);
+        env->warnings |= ENV_WARNING_PIN_FAILED;
+        return;
+    }
+
+    CPU_SET(config->cpu, &cpus);
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpus)) {
+        LOG(WARNING, "Can't pin benchmark thread to CPU %d: %s\n", config->cpu, strerror(errno));
+        env->warnings |= ENV_WARNING_PIN_FAILED;
+        return;
+    }
+
+    env->pinned = true;
+    env->cpu = config->cpu;
+}
+
+// Lowers the nice value of the calling thread to the minimum; without CAP_SYS_NICE this fails
+// and the run goes on with a warning.
+static void raise_priority(environment_t* env) {
+    environment_state_t* saved = saved_state();
+
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, 0);
+    if (errno) {
+        env->warnings |= ENV_WARNING_PRIORITY;
+        return;
+    }
+
+    if (!saved->nice_saved) {
+        saved->nice = nice;
+        saved->nice_saved = true;
+    }
+
+    if (setpriority(PRIO_PROCESS, 0, HIGHEST_NICE)) {
+        LOG(WARNING, "Can't raise scheduling priority: %s\n", strerror(errno));
+        env->warnings |= ENV_WARNING_PRIORITY;
+        return;
+    }
+
+    env->priority_raised = true;
+}
+
+static void read_cpu_info(environment_t* env) {
+    char path[FILENAME_MAX] = {};
+
+    if (env->cpu >= 0) {
+        snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/scaling_governor", SYSFS_CPU, env->cpu);
+        read_sysfs_str(path, env->governor, sizeof(env->governor));
+
+        snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/scaling_cur_freq", SYSFS_CPU, env->cpu);
+        env->cur_freq = read_sysfs_long(path);
+
+        snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/scaling_min_freq", SYSFS_CPU, env->cpu);
+        env->min_freq = read_sysfs_long(path);
+
+        snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/scaling_max_freq", SYSFS_CPU, env->cpu);
+        env->max_freq = read_sysfs_long(path);
+
+        snprintf(path, sizeof(path), "%s/cpu%d/topology/thread_siblings_list", SYSFS_CPU, env->cpu);
+        read_sysfs_str(path, env->smt_siblings, sizeof(env->smt_siblings));
+    }
+
+    // intel_pstate exposes the inverse knob, acpi-cpufreq and amd-pstate expose "boost".
+    snprintf(path, sizeof(path), "%s/intel_pstate/no_turbo", SYSFS_CPU);
+    long no_turbo = read_sysfs_long(path);
+
+    if (no_turbo >= 0) {
+        env->turbo = !no_turbo;
+    }
+    else {
+        snprintf(path, sizeof(path), "%s/cpufreq/boost", SYSFS_CPU);
+        long boost = read_sysfs_long(path);
+        env->turbo = boost >= 0 ? (int) boost : -1;
+    }
+}
+
+static bool read_sysfs_str(const char* path, char* str, size_t size) {
+    assert(path);
+    assert(str);
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        str[0] = '\0';
+        return false;
+    }
+
+    bool read = fgets(str, (int) size, file);
+    fclose(file);
+
+    if (!read) {
+        str[0] = '\0';
+        return false;
+    }
+
+    str[strcspn(str, "\n")] = '\0';
+    return true;
+}
+
+static long read_sysfs_long(const char* path) {
+    char str[ENVIRONMENT_MAX_STR_LEN] = {};
+
+    if (!read_sysfs_str(path, str, sizeof(str))) {
+        return -1;
+    }
+
+    return strtol(str, nullptr, 10);
+}
@@ -0,0 +1,54 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <stdio.h>
+#include <sched.h>
+
+#define ENVIRONMENT_MAX_STR_LEN 64
+#define ENVIRONMENT_WARNINGS_CNT 6
+
+typedef enum {
+    ENV_WARNING_PIN_FAILED   = 1 << 0,
+    ENV_WARNING_NOT_PINNED   = 1 << 1,
+    ENV_WARNING_PRIORITY     = 1 << 2,
+    ENV_WARNING_GOVERNOR     = 1 << 3,
+    ENV_WARNING_TURBO        = 1 << 4,
+    ENV_WARNING_SMT          = 1 << 5,
+} environment_warning_t;
+
+typedef struct {
+    bool enabled;
+    bool pin;
+    int cpu;
+    bool raise_priority;
+} environment_config_t;
+
+typedef struct {
+    bool checked;
+    int cpu;
+    bool pinned;
+    bool priority_raised;
+    int nice;
+
+    char governor[ENVIRONMENT_MAX_STR_LEN];
+    long cur_freq;   // kHz
+    long min_freq;   // kHz
+    long max_freq;   // kHz
+    int turbo;       // 1 enabled, 0 disabled, -1 unknown
+    char smt_siblings[ENVIRONMENT_MAX_STR_LEN];
+
+    unsigned warnings;
+} environment_t;
+
+typedef struct {
+    bool affinity_saved;
+    cpu_set_t affinity;
+    bool nice_saved;
+    int nice;
+} environment_state_t;
+
+void environment_setup(const environment_config_t* config, environment_t* env);
+void environment_restore();
+const char* environment_warning_name(environment_warning_t warning);
+
+#endif /* ENVIRONMENT_H */
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "flight_recorder.h"
+#include "typed_vector.h"
+#include "logger.h"
+
+static void copy_to_ring(char* data, uint64_t capacity, uint64_t position, const char* src, size_t len);
+static void copy_from_ring(const char* data, uint64_t capacity, uint64_t position, char* dst, size_t len);
+static uint64_t record_size(uint32_t len);
+static int compare_positions(const void* first, const void* second);
+
+//============================================================================================================
+
+const uint64_t FLIGHT_RECORD_ALIGNMENT = sizeof(flight_record_header_t);
+
+//============================================================================================================
+
+bool flight_recorder_ctor(flight_recorder_t* recorder, const char* path, size_t capacity) {
+    assert(recorder);
+    assert(path);
+
+    memset(recorder, 0, sizeof(flight_recorder_t));
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    capacity = (capacity + page_size - 1) & ~(page_size - 1);
+
+    // The header takes a page of its own, so that the data area stays page aligned.
+    size_t mapping_size = page_size + capacity;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG(ERROR, "Can't open the flight recorder %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(fd, (off_t) mapping_size)) {
+        LOG(ERROR, "Can't resize the flight recorder %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR, "Can't map the flight recorder %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    recorder->mapping = (char*) mapping;
+    recorder->mapping_size = mapping_size;
+    recorder->header = (flight_recorder_header_t*) mapping;
+    recorder->data = recorder->mapping + page_size;
+    recorder->capacity = capacity;
+
+    memcpy(recorder->header->magic, FLIGHT_RECORDER_MAGIC, sizeof(recorder->header->magic));
+    recorder->header->capacity = capacity;
+    recorder->header->head.store(0, std::memory_order_release);
+    return true;
+}
+
+void flight_recorder_dtor(flight_recorder_t* recorder) {
+    assert(recorder);
+
+    if (recorder->mapping) {
+        munmap(recorder->mapping, recorder->mapping_size);
+    }
+
+    memset(recorder, 0, sizeof(flight_recorder_t));
+}
+
+void flight_recorder_write(flight_recorder_t* recorder, const char* text, size_t len) {
+    assert(recorder);
+    assert(text);
+
+    if (!recorder->mapping) {
+        return;
+    }
+
+    uint64_t max_len = recorder->capacity / 2 - sizeof(flight_record_header_t);
+    if (len > max_len) {
+        len = max_len;
+    }
+
+    uint64_t position = recorder->header->head.fetch_add(record_size((uint32_t) len), std::memory_order_relaxed);
+    uint64_t offset = position % recorder->capacity;
+
+    flight_record_header_t* header = (flight_record_header_t*) (recorder->data + offset);
+
+    // Until the new tag is stored, the old one doesn't match the head any more and the record is skipped.
+    header->tag.store(0, std::memory_order_relaxed);
+    header->len = (uint32_t) len;
+    copy_to_ring(recorder->data, recorder->capacity, position + sizeof(flight_record_header_t), text, len);
+
+    header->tag.store(position + 1, std::memory_order_release);
+}
+
+//============================================================================================================
+
+typedef struct {
+    uint64_t position;
+    uint32_t len;
+} flight_record_ref_t;
+
+bool flight_recorder_dump(const char* path, size_t cnt, FILE* out) {
+    assert(path);
+    assert(out);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG(ERROR, "Can't open the flight recorder %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat file_stat = {};
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    if (fstat(fd, &file_stat) || (size_t) file_stat.st_size < page_size) {
+        LOG(ERROR, "%s is not a flight recorder\n", path);
+        close(fd);
+        return false;
+    }
+
+    size_t mapping_size = (size_t) file_stat.st_size;
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR, "Can't map the flight recorder %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    const flight_recorder_header_t* header = (const flight_recorder_header_t*) mapping;
+    const char* data = (const char*) mapping + page_size;
+    uint64_t capacity = header->capacity;
+
+    if (memcmp(header->magic, FLIGHT_RECORDER_MAGIC, sizeof(header->magic)) ||
+        capacity == 0 || capacity % FLIGHT_RECORD_ALIGNMENT || capacity > mapping_size - page_size) {
+        LOG(ERROR, "%s is not a flight recorder\n", path);
+        munmap(mapping, mapping_size);
+        return false;
+    }
+
+    uint64_t head = header->head.load(std::memory_order_acquire);
+    uint64_t oldest = head > capacity ? head - capacity : 0;
+    vector<flight_record_ref_t> records;
+
+    for (uint64_t offset = 0; offset < capacity; offset += FLIGHT_RECORD_ALIGNMENT) {
+        const flight_record_header_t* record = (const flight_record_header_t*) (data + offset);
+        uint64_t tag = record->tag.load(std::memory_order_acquire);
+
+        if (tag == 0) {
+            continue;
+        }
+
+        uint64_t position = tag - 1;
+
+        if (position % capacity != offset || position < oldest ||
+            record->len > capacity / 2 || position + record_size(record->len) > head) {
+            continue;
+        }
+
+        records.push_back({position, record->len});
+    }
+
+    qsort(records.data, records.size, sizeof(flight_record_ref_t), compare_positions);
+
+    size_t first = cnt && cnt < records.size ? records.size - cnt : 0;
+    char* text = (char*) malloc(capacity / 2);
+
+    for (size_t i = first; text && i < records.size; i++) {
+        copy_from_ring(data, capacity, records[i].position + sizeof(flight_record_header_t), text, records[i].len);
+        fwrite(text, 1, records[i].len, out);
+    }
+
+    free(text);
+    munmap(mapping, mapping_size);
+    return text != nullptr;
+}
+
+//============================================================================================================
+
+static void copy_to_ring(char* data, uint64_t capacity, uint64_t position, const char* src, size_t len) {
+    uint64_t offset = position % capacity;
+    size_t first = len < capacity - offset ? len : (size_t) (capacity - offset);
+
+    memcpy(data + offset, src, first);
+    memcpy(data, src + first, len - first);
+}
+
+static void copy_from_ring(const char* data, uint64_t capacity, uint64_t position, char* dst, size_t len) {
+    uint64_t offset = position % capacity;
+    size_t first = len < capacity - offset ? len : (size_t) (capacity - offset);
+
+    memcpy(dst, data + offset, first);
+    memcpy(dst + first, data, len - first);
+}
+
+static uint64_t record_size(uint32_t len) {
+    return (sizeof(flight_record_header_t) + len + FLIGHT_RECORD_ALIGNMENT - 1) & ~(FLIGHT_RECORD_ALIGNMENT - 1);
+}
+
+static int compare_positions(const void* first, const void* second) {
+    uint64_t a = ((const flight_record_ref_t*) first)->position;
+    uint64_t b = ((const flight_record_ref_t*) second)->position;
+
+    return (a > b) - (a < b);
+}
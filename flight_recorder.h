@@ -0,0 +1,49 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+// Circular log in a shared mapping of a file. A write reserves space by advancing the head and copies the
+// record in with plain stores, so it makes no system call; the kernel writes the pages back on its own and
+// the file keeps the latest records when the process dies. Once the ring is full the oldest records are
+// overwritten.
+//
+// Every record starts on a 16-byte boundary with a header whose tag is its absolute position plus one,
+// stored last. A reader accepts a header only if the tag matches where it lies and the record is still
+// within the last capacity bytes before the head, so records torn by a crash or overwritten are skipped.
+
+#define FLIGHT_RECORDER_MAGIC "BMFLIGHT"
+
+typedef struct {
+    char magic[8];
+    uint64_t capacity;          // of the data area, a multiple of the page size
+    std::atomic<uint64_t> head; // bytes ever reserved
+} flight_recorder_header_t;
+
+typedef struct {
+    std::atomic<uint64_t> tag;  // position + 1, 0 before the first write
+    uint32_t len;
+    uint32_t reserved;
+} flight_record_header_t;
+
+typedef struct {
+    char* mapping;
+    size_t mapping_size;
+    flight_recorder_header_t* header;
+    char* data;
+    uint64_t capacity;
+} flight_recorder_t;
+
+// Creates or truncates the file at path with room for about capacity bytes of records.
+bool flight_recorder_ctor(flight_recorder_t* recorder, const char* path, size_t capacity);
+void flight_recorder_dtor(flight_recorder_t* recorder);
+
+// Safe to call from any number of threads, and from processes forked after the ctor.
+void flight_recorder_write(flight_recorder_t* recorder, const char* text, size_t len);
+
+// Writes the last cnt records of the file at path to out, oldest first; cnt 0 writes all of them.
+bool flight_recorder_dump(const char* path, size_t cnt, FILE* out);
+
+#endif /* FLIGHT_RECORDER_H */
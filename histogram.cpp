@@ -0,0 +1,87 @@
+#include <assert.h>
+#include <math.h>
+
+#include "histogram.h"
+
+//============================================================================================================
+
+void histogram_reset(histogram_t* histogram) {
+    assert(histogram);
+
+    memset(histogram, 0, sizeof(histogram_t));
+}
+
+void histogram_merge(histogram_t* dst, const histogram_t* src) {
+    assert(dst);
+    assert(src);
+
+    if (!src->total) {
+        return;
+    }
+
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+
+    if (!dst->total || src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (!dst->total || src->max > dst->max) {
+        dst->max = src->max;
+    }
+
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+//============================================================================================================
+
+// Midpoint of the bucket at the requested rank, clamped to the exact extremes so that
+// p = 0 and p = 1 return the recorded min and max.
+double histogram_percentile(const histogram_t* histogram, double p) {
+    assert(histogram);
+
+    if (!histogram->total) {
+        return 0;
+    }
+    if (p <= 0) {
+        return histogram->min;
+    }
+    if (p >= 1) {
+        return histogram->max;
+    }
+
+    uint64_t rank = (uint64_t) ceil(p * (double) histogram->total);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+
+        if (seen >= rank) {
+            double value = histogram_bucket_value(i);
+            return fmin(fmax(value, histogram->min), histogram->max);
+        }
+    }
+
+    return histogram->max;
+}
+
+double histogram_mean(const histogram_t* histogram) {
+    assert(histogram);
+
+    return histogram->total ? histogram->sum / (double) histogram->total : 0;
+}
+
+double histogram_bucket_value(size_t bucket) {
+    assert(bucket < HISTOGRAM_BUCKETS);
+
+    const size_t SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+
+    int exponent = (int) (bucket >> HISTOGRAM_SUB_BUCKET_BITS) + HISTOGRAM_MIN_EXPONENT;
+    double sub_bucket = (double) (bucket & (SUB_BUCKETS - 1)) + 0.5;
+
+    return ldexp(1 + sub_bucket / SUB_BUCKETS, exponent);
+}
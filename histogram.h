@@ -0,0 +1,73 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+// Log-linear buckets: every power of two in [2^HISTOGRAM_MIN_EXPONENT, 2^HISTOGRAM_MAX_EXPONENT) is split
+// into 2^HISTOGRAM_SUB_BUCKET_BITS equal sub-buckets, so a bucket is never wider than 1/128 of its values
+// and the midpoint it reports is within 0.4% of any value recorded in it.
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_MIN_EXPONENT  (-20)
+#define HISTOGRAM_MAX_EXPONENT  44
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_MIN_EXPONENT) << HISTOGRAM_SUB_BUCKET_BITS)
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+
+    double min;
+    double max;
+    double sum;
+} histogram_t;
+
+//============================================================================================================
+
+// The exponent and the top mantissa bits of a positive double, read as one integer,
+// grow monotonically with the value and are exactly the log-linear bucket index.
+inline size_t histogram_bucket(double value) {
+    const uint64_t DOUBLE_EXPONENT_BIAS = 1023;
+    const uint64_t DOUBLE_MANTISSA_BITS = 52;
+    const uint64_t FIRST_KEY = (DOUBLE_EXPONENT_BIAS + HISTOGRAM_MIN_EXPONENT) << HISTOGRAM_SUB_BUCKET_BITS;
+
+    if (!(value > 0)) {
+        return 0;
+    }
+
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint64_t key = bits >> (DOUBLE_MANTISSA_BITS - HISTOGRAM_SUB_BUCKET_BITS);
+    if (key < FIRST_KEY) {
+        return 0;
+    }
+
+    key -= FIRST_KEY;
+    return key < HISTOGRAM_BUCKETS ? key : HISTOGRAM_BUCKETS - 1;
+}
+
+inline void histogram_record(histogram_t* histogram, double value) {
+    histogram->counts[histogram_bucket(value)]++;
+
+    if (!histogram->total || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (!histogram->total || value > histogram->max) {
+        histogram->max = value;
+    }
+
+    histogram->total++;
+    histogram->sum += value;
+}
+
+//============================================================================================================
+
+void histogram_reset(histogram_t* histogram);
+void histogram_merge(histogram_t* dst, const histogram_t* src);
+
+double histogram_percentile(const histogram_t* histogram, double p);
+double histogram_mean(const histogram_t* histogram);
+double histogram_bucket_value(size_t bucket);
+
+#endif /* HISTOGRAM_H */
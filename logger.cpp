@@ -2,29 +2,122 @@
 #include <assert.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <atomic>
 #include "logger.h"
+#include "typed_vector.h"
 #include "define_colors.h"
 
 static const char* LogMessageTypePrint(enum LogLevel level, bool color);
-static void TimePrint(FILE *out);
-static void AestheticizeString(const char *src, char *dst, size_t max_len);
+static size_t TimePrint(char* dst, size_t size, time_t seconds);
+static size_t AestheticizeString(const char *src, char *dst, size_t max_len, bool* fits);
+static size_t FormatRecord(char* dst, enum LogLevel status, const char* file, size_t line, const char* func,
+                           time_t seconds, const char* body, bool body_fits, bool color);
+static size_t FormatRecord(char* dst, enum LogLevel status, const char* file, size_t line, const char* func,
+                           const char* fmt, va_list args);
 
-const size_t MAXLINE = 100;
+static void Enqueue(enum LogLevel status, const char* file, size_t line, const char* func,
+                    const char* fmt, va_list args);
+static void* WriterThread(void*);
+static bool WriteBatch(char* batch, size_t* batch_len);
+static void WriteDropped(char* batch, size_t* batch_len);
+static void AfterFork();
+
+static void WriteOut(const char* text, size_t len);
+static void FlushOut();
+
+static void FlushThreadBuffer();
+static bool WriteSite(FILE* out, const log_site_t* site);
+static bool DecodeRecord(const log_site_t* site, const char* args, size_t size, char* body, bool* fits);
+static bool DecodeArg(char* dst, size_t size, const char* spec, char conversion, char type,
+                      const char** args, const char* end, size_t* written);
+
+const size_t LOG_BATCH_SIZE = 64 * LOG_RECORD_SIZE;
+const long LOG_IDLE_NS = 1000000;
+const char TRUNCATION_MARK[] = "...\n";
+
+//----------------------------------------------------------------------------------------------
+
+// Records are handed from any number of logging threads to the writer thread through a bounded
+// queue: every slot carries a sequence number that tells whose turn it is (D. Vyukov's MPMC queue,
+// used here with a single consumer).
+typedef struct {
+    std::atomic<size_t> sequence;
+    size_t len;
+    char text[LOG_RECORD_SIZE];
+} log_record_t;
+
+typedef struct {
+    log_record_t* records;
+    size_t mask;
+    enum LogOverflow overflow;
+
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) size_t dequeue_pos;
+    std::atomic<size_t> written;
+    std::atomic<uint64_t> dropped;
+    std::atomic<size_t> producers;    // threads between the running check and the publication of a record
+
+    pthread_t writer;
+    std::atomic<bool> stop;
+    std::atomic<bool> running;
+} async_logger_t;
+
+// Deferred binary logging: records are staged per thread and appended to the file a buffer at a time.
+typedef struct {
+    FILE* file_out;
+    std::atomic<bool> active;
+    pthread_mutex_t mutex;      // guards the file and the list of sites
+    log_site_t* sites;
+    uint32_t sites_cnt;
+} binary_logger_t;
+
+const size_t LOG_BINARY_BUFFER_SIZE = 64 * LOG_RECORD_SIZE;
+
+// The destructor writes out what the thread logged when it exits.
+struct log_thread_buffer_t {
+    char* data;
+    size_t used;
+
+    ~log_thread_buffer_t() {
+        FlushThreadBuffer();
+        free(data);
+        data = nullptr;
+    }
+};
 
 //----------------------------------------------------------------------------------------------
 
 static logger_t* GetLogger() {
-    static logger_t logger = {};
+    static logger_t logger = {stderr, DEBUG, {}};
     return &logger;
 }
 
-void LoggerSetFile(FILE* out) {
-    assert(out != nullptr);
+static async_logger_t* GetAsyncLogger() {
+    static async_logger_t async_logger;
+    return &async_logger;
+}
+
+static binary_logger_t* GetBinaryLogger() {
+    static binary_logger_t binary_logger = {nullptr, {false}, PTHREAD_MUTEX_INITIALIZER, nullptr, 0};
+    return &binary_logger;
+}
+
+static log_thread_buffer_t* GetThreadBuffer() {
+    thread_local log_thread_buffer_t buffer = {nullptr, 0};
+    return &buffer;
+}
 
+void LoggerSetFile(FILE* out, bool unbuffered) {
+    LoggerFlush();
     GetLogger()->file_out = out;
 
-    if (setvbuf(GetLogger()->file_out, nullptr, _IONBF, 0)) {
-        fprintf(stderr, "WARNING\n");
+    if (out && unbuffered && setvbuf(out, nullptr, _IONBF, 0)) {
+        fprintf(stderr, "Can't make the log file unbuffered\n");
     }
 }
 
@@ -32,6 +125,19 @@ void LoggerSetLevel(enum LogLevel level) {
     GetLogger()->min_level = level;
 }
 
+// Not to be called while other threads log.
+bool LoggerSetFlightRecorder(const char* path, size_t size) {
+    flight_recorder_t* flight_recorder = &GetLogger()->flight_recorder;
+
+    flight_recorder_dtor(flight_recorder);
+
+    if (!path) {
+        return true;
+    }
+
+    return flight_recorder_ctor(flight_recorder, path, size);
+}
+
 //----------------------------------------------------------------------------------------------
 
 void Log(enum LogLevel status, const char* file, size_t line, const char* func, const char *fmt, ...) {
@@ -41,27 +147,705 @@ void Log(enum LogLevel status, const char* file, size_t line, const char* func,
         return;
     }
 
-    char dst[MAXLINE] = "";
-    AestheticizeString(fmt, dst, MAXLINE);
-
     va_list args;
     va_start (args, fmt);
 
-    bool color = GetLogger()->file_out == stderr || GetLogger()->file_out == stdout;
-    fprintf(GetLogger()->file_out, "%s:%zu (%s)\n", file, line, func);
-    fprintf(GetLogger()->file_out, "%s", LogMessageTypePrint (status, color));
-    TimePrint(GetLogger()->file_out);
+    async_logger_t* async_logger = GetAsyncLogger();
+    bool queued = false;
+
+    if (async_logger->running.load(std::memory_order_acquire)) {
+        async_logger->producers.fetch_add(1);
+        if (async_logger->running.load()) {
+            Enqueue(status, file, line, func, fmt, args);
+            queued = true;
+        }
+        async_logger->producers.fetch_sub(1);
+    }
+
+    if (!queued) {
+        char record[LOG_RECORD_SIZE] = "";
+        size_t len = FormatRecord(record, status, file, line, func, fmt, args);
+
+        flight_recorder_write(&GetLogger()->flight_recorder, record, len);
+        WriteOut(record, len);
+
+        if (status >= ERROR) {
+            FlushOut();
+        }
+    }
+
+    va_end (args);
+}
+
+//----------------------------------------------------------------------------------------------
+
+bool LoggerStartAsync(size_t capacity, enum LogOverflow overflow) {
+    async_logger_t* async_logger = GetAsyncLogger();
+
+    if (async_logger->running.load(std::memory_order_acquire)) {
+        return true;
+    }
+
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    log_record_t* records = (log_record_t*) calloc(rounded, sizeof(log_record_t));
+    if (!records) {
+        fprintf(stderr, "Can't allocate the log queue: %s\n", strerror(errno));
+        return false;
+    }
+
+    for (size_t i = 0; i < rounded; i++) {
+        records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    async_logger->records = records;
+    async_logger->mask = rounded - 1;
+    async_logger->overflow = overflow;
+    async_logger->enqueue_pos.store(0, std::memory_order_relaxed);
+    async_logger->dequeue_pos = 0;
+    async_logger->written.store(0, std::memory_order_relaxed);
+    async_logger->dropped.store(0, std::memory_order_relaxed);
+    async_logger->producers.store(0, std::memory_order_relaxed);
+    async_logger->stop.store(false, std::memory_order_relaxed);
+
+    int error = pthread_create(&async_logger->writer, nullptr, WriterThread, nullptr);
+    if (error) {
+        fprintf(stderr, "Can't start the log writer thread: %s\n", strerror(error));
+        free(records);
+        async_logger->records = nullptr;
+        return false;
+    }
+
+    static bool registered = false;
+    if (!registered) {
+        atexit(LoggerStopAsync);
+        pthread_atfork(nullptr, nullptr, AfterFork);
+        registered = true;
+    }
+
+    async_logger->running.store(true, std::memory_order_release);
+    return true;
+}
+
+// Messages logged after running is cleared are written synchronously, the ones already queued are
+// drained by the writer before it exits.
+void LoggerStopAsync() {
+    async_logger_t* async_logger = GetAsyncLogger();
+
+    if (!async_logger->running.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    async_logger->running.store(false);
+    while (async_logger->producers.load()) {
+        sched_yield();
+    }
+
+    async_logger->stop.store(true, std::memory_order_release);
+    pthread_join(async_logger->writer, nullptr);
+    FlushOut();
+
+    free(async_logger->records);
+    async_logger->records = nullptr;
+}
+
+void LoggerFlush() {
+    async_logger_t* async_logger = GetAsyncLogger();
+
+    if (GetBinaryLogger()->active.load(std::memory_order_acquire)) {
+        FlushThreadBuffer();
+
+        pthread_mutex_lock(&GetBinaryLogger()->mutex);
+        fflush(GetBinaryLogger()->file_out);
+        pthread_mutex_unlock(&GetBinaryLogger()->mutex);
+    }
+
+    if (async_logger->running.load(std::memory_order_acquire)) {
+        size_t target = async_logger->enqueue_pos.load(std::memory_order_acquire);
+
+        while (async_logger->written.load(std::memory_order_acquire) < target) {
+            sched_yield();
+        }
+    }
+
+    FlushOut();
+}
+
+//----------------------------------------------------------------------------------------------
+
+// Formats straight into the claimed slot. A full queue either drops the message or waits for the
+// writer, depending on the overflow policy.
+static void Enqueue(enum LogLevel status, const char* file, size_t line, const char* func,
+                    const char* fmt, va_list args) {
+    async_logger_t* async_logger = GetAsyncLogger();
+    size_t pos = async_logger->enqueue_pos.load(std::memory_order_relaxed);
+    log_record_t* record = nullptr;
+
+    while (true) {
+        record = &async_logger->records[pos & async_logger->mask];
+
+        size_t sequence = record->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+
+        if (diff == 0) {
+            if (async_logger->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            if (async_logger->overflow == LOG_OVERFLOW_DROP) {
+                async_logger->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            sched_yield();
+            pos = async_logger->enqueue_pos.load(std::memory_order_relaxed);
+        }
+        else {
+            pos = async_logger->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->len = FormatRecord(record->text, status, file, line, func, fmt, args);
+    flight_recorder_write(&GetLogger()->flight_recorder, record->text, record->len);
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Collects the published records into one buffer per wakeup, so that a burst of messages costs a
+// single write.
+static void* WriterThread(void*) {
+    async_logger_t* async_logger = GetAsyncLogger();
+    const struct timespec idle = {0, LOG_IDLE_NS};
+
+    char* batch = (char*) malloc(LOG_BATCH_SIZE);
+    size_t batch_len = 0;
+
+    while (true) {
+        bool stopping = async_logger->stop.load(std::memory_order_acquire);
+
+        if (WriteBatch(batch, &batch_len)) {
+            continue;
+        }
+
+        if (stopping && async_logger->dequeue_pos == async_logger->enqueue_pos.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        nanosleep(&idle, nullptr);
+    }
+
+    free(batch);
+    return nullptr;
+}
+
+// Returns false if there was nothing to write.
+static bool WriteBatch(char* batch, size_t* batch_len) {
+    async_logger_t* async_logger = GetAsyncLogger();
+    size_t written = 0;
+
+    WriteDropped(batch, batch_len);
+
+    while (true) {
+        log_record_t* record = &async_logger->records[async_logger->dequeue_pos & async_logger->mask];
+
+        if (record->sequence.load(std::memory_order_acquire) != async_logger->dequeue_pos + 1) {
+            break;
+        }
+
+        if (*batch_len + record->len > LOG_BATCH_SIZE) {
+            WriteOut(batch, *batch_len);
+            *batch_len = 0;
+        }
+
+        memcpy(batch + *batch_len, record->text, record->len);
+        *batch_len += record->len;
+
+        record->sequence.store(async_logger->dequeue_pos + async_logger->mask + 1, std::memory_order_release);
+        async_logger->dequeue_pos++;
+        written++;
+    }
+
+    if (*batch_len) {
+        WriteOut(batch, *batch_len);
+        FlushOut();
+        *batch_len = 0;
+    }
+
+    async_logger->written.store(async_logger->dequeue_pos, std::memory_order_release);
+    return written != 0;
+}
+
+static void WriteDropped(char* batch, size_t* batch_len) {
+    uint64_t dropped = GetAsyncLogger()->dropped.exchange(0, std::memory_order_relaxed);
+
+    if (dropped) {
+        *batch_len += (size_t) snprintf(batch + *batch_len, LOG_RECORD_SIZE, "[WARNING] %llu log messages dropped\n",
+                                        (unsigned long long) dropped);
+    }
+}
+
+static void WriteOut(const char* text, size_t len) {
+    if (GetLogger()->file_out) {
+        fwrite(text, 1, len, GetLogger()->file_out);
+    }
+}
+
+static void FlushOut() {
+    if (GetLogger()->file_out) {
+        fflush(GetLogger()->file_out);
+    }
+}
+
+// The writer thread doesn't exist in the child, and the records staged by the forking thread belong
+// to the parent.
+static void AfterFork() {
+    GetAsyncLogger()->running.store(false, std::memory_order_relaxed);
+    GetThreadBuffer()->used = 0;
+}
+
+//----------------------------------------------------------------------------------------------
+
+bool LoggerSetBinaryFile(FILE* out) {
+    binary_logger_t* binary_logger = GetBinaryLogger();
+
+    FlushThreadBuffer();
+    pthread_mutex_lock(&binary_logger->mutex);
+
+    if (binary_logger->file_out) {
+        fflush(binary_logger->file_out);
+    }
+
+    binary_logger->file_out = out;
+    bool written = true;
+
+    // Sites registered for an earlier file are defined again, their records may follow in this one.
+    if (out) {
+        written = fwrite(LOG_BINARY_MAGIC, 1, sizeof(LOG_BINARY_MAGIC), out) == sizeof(LOG_BINARY_MAGIC);
+
+        for (const log_site_t* site = binary_logger->sites; site && written; site = site->next) {
+            written = WriteSite(out, site);
+        }
+    }
+
+    binary_logger->active.store(out != nullptr, std::memory_order_release);
+    pthread_mutex_unlock(&binary_logger->mutex);
+
+    if (!written) {
+        fprintf(stderr, "Can't write the binary log: %s\n", strerror(errno));
+    }
+    return written;
+}
+
+bool LoggerBinaryActive() {
+    return GetBinaryLogger()->active.load(std::memory_order_relaxed);
+}
+
+uint32_t LogStringLen(const char* value) {
+    return value ? (uint32_t) strnlen(value, LOG_RECORD_SIZE) : 0;
+}
+
+uint32_t LogRegisterSite(log_site_t* site, const char* fmt, const char* arg_types) {
+    binary_logger_t* binary_logger = GetBinaryLogger();
+
+    pthread_mutex_lock(&binary_logger->mutex);
+
+    uint32_t id = site->id.load(std::memory_order_relaxed);
+
+    if (!id) {
+        id = ++binary_logger->sites_cnt;
+
+        site->fmt = fmt;
+        site->arg_types = arg_types;
+        site->next = binary_logger->sites;
+        binary_logger->sites = site;
+
+        site->id.store(id, std::memory_order_release);
+
+        if (binary_logger->file_out) {
+            WriteSite(binary_logger->file_out, site);
+        }
+    }
+
+    pthread_mutex_unlock(&binary_logger->mutex);
+    return id;
+}
+
+char* LogBinaryReserve(const log_site_t* site, uint32_t id, size_t size) {
+    if (GetLogger()->min_level > site->level) {
+        return nullptr;
+    }
+
+    log_thread_buffer_t* buffer = GetThreadBuffer();
+    size_t record_size = sizeof(log_binary_header_t) + size;
+
+    if (record_size > LOG_BINARY_BUFFER_SIZE) {
+        return nullptr;
+    }
+
+    if (!buffer->data) {
+        buffer->data = (char*) malloc(LOG_BINARY_BUFFER_SIZE);
+        if (!buffer->data) {
+            return nullptr;
+        }
+    }
+
+    if (buffer->used + record_size > LOG_BINARY_BUFFER_SIZE) {
+        FlushThreadBuffer();
+    }
+
+    struct timespec now = {};
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    log_binary_header_t header = {id, (uint32_t) size,
+                                  (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec};
+
+    char* record = buffer->data + buffer->used;
+    memcpy(record, &header, sizeof(header));
+    buffer->used += record_size;
+
+    return record + sizeof(header);
+}
+
+static void FlushThreadBuffer() {
+    binary_logger_t* binary_logger = GetBinaryLogger();
+    log_thread_buffer_t* buffer = GetThreadBuffer();
+
+    if (!buffer->used) {
+        return;
+    }
+
+    pthread_mutex_lock(&binary_logger->mutex);
+    if (binary_logger->file_out) {
+        fwrite(buffer->data, 1, buffer->used, binary_logger->file_out);
+    }
+    pthread_mutex_unlock(&binary_logger->mutex);
+
+    buffer->used = 0;
+}
+
+// A site definition: its id, level and line, then the file, function, format and argument types as
+// length-prefixed strings.
+static bool WriteSite(FILE* out, const log_site_t* site) {
+    const char* strings[] = {site->file, site->func, site->fmt, site->arg_types};
+    char payload[5 * LOG_RECORD_SIZE] = "";
+    char* dst = payload;
+
+    uint32_t fields[] = {site->id.load(std::memory_order_relaxed), (uint32_t) site->level, (uint32_t) site->line};
+    memcpy(dst, fields, sizeof(fields));
+    dst += sizeof(fields);
+
+    for (const char* string : strings) {
+        LogArgEncode(&dst, string);
+    }
+
+    log_binary_header_t header = {LOG_BINARY_SITE, (uint32_t) (dst - payload), 0};
+
+    return fwrite(&header, sizeof(header), 1, out) == 1 &&
+           fwrite(payload, 1, header.size, out) == header.size;
+}
+
+//----------------------------------------------------------------------------------------------
+
+bool LoggerDecodeBinary(FILE* in, FILE* out) {
+    assert(in != nullptr);
+    assert(out != nullptr);
+
+    char magic[sizeof(LOG_BINARY_MAGIC)] = "";
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic))) {
+        fprintf(stderr, "Not a binary log\n");
+        return false;
+    }
+
+    vector<log_site_t*> sites;
+    vector<char> payload;
+    bool valid = true;
+
+    log_binary_header_t header = {};
+
+    while (valid && fread(&header, sizeof(header), 1, in) == 1) {
+        payload.clear();
+        if (header.size > LOG_BINARY_BUFFER_SIZE || !payload.reserve(header.size + 1) || fread(payload.data, 1, header.size, in) != header.size) {
+            valid = false;
+            break;
+        }
+
+        const char* args = payload.data;
+        const char* end = payload.data + header.size;
+
+        if (header.site == LOG_BINARY_SITE) {
+            log_site_t* site = (log_site_t*) calloc(1, sizeof(log_site_t));
+            uint32_t fields[3] = {};
+            char* strings[4] = {};
+
+            valid = site && header.size >= sizeof(fields);
+            if (valid) {
+                memcpy(fields, args, sizeof(fields));
+                args += sizeof(fields);
+            }
+
+            for (size_t i = 0; i < 4 && valid; i++) {
+                uint32_t len = 0;
+                valid = (size_t) (end - args) >= sizeof(len) &&
+                        (memcpy(&len, args, sizeof(len)), len <= (size_t) (end - args) - sizeof(len));
+
+                if (valid) {
+                    strings[i] = strndup(args + sizeof(len), len);
+                    args += sizeof(len) + len;
+                }
+            }
+
+            if (valid) {
+                site->id.store(fields[0], std::memory_order_relaxed);
+                site->level = (enum LogLevel) fields[1];
+                site->line = fields[2];
+                site->file = strings[0];
+                site->func = strings[1];
+                site->fmt = strings[2];
+                site->arg_types = strings[3];
+                valid = sites.push_back(site);
+            }
+            else {
+                for (char* string : strings) {
+                    free(string);
+                }
+                free(site);
+            }
+            continue;
+        }
+
+        const log_site_t* site = nullptr;
+        for (const log_site_t* known : sites) {
+            if (known->id.load(std::memory_order_relaxed) == header.site) {
+                site = known;
+            }
+        }
+
+        char body[LOG_RECORD_SIZE] = "";
+        char record[LOG_RECORD_SIZE] = "";
+
+        if (!site) {
+            valid = false;
+            break;
+        }
+
+        bool fits = false;
+        if (!DecodeRecord(site, args, header.size, body, &fits)) {
+            valid = false;
+            break;
+        }
+
+        size_t len = FormatRecord(record, site->level, site->file, site->line, site->func,
+                                  (time_t) (header.timestamp / 1000000000), body, fits, false);
+        fwrite(record, 1, len, out);
+    }
+
+    if (!valid || ferror(in)) {
+        fprintf(stderr, "Binary log is damaged after %zu sites\n", sites.size);
+        valid = false;
+    }
+
+    for (log_site_t* site : sites) {
+        free((void*) site->file);
+        free((void*) site->func);
+        free((void*) site->fmt);
+        free((void*) site->arg_types);
+        free(site);
+    }
+
+    return valid;
+}
+
+// Renders the format of the site with the recorded arguments into body[LOG_RECORD_SIZE]. Each conversion
+// is printed on its own with the length modifier replaced by the one of the recorded type. Returns false
+// if the arguments don't match the site, fits tells whether the message had to be cut.
+static bool DecodeRecord(const log_site_t* site, const char* args, size_t size, char* body, bool* fits) {
+    const char* end = args + size;
+    const char* fmt = site->fmt;
+    const char* types = site->arg_types;
+    size_t len = 0;
+
+    while (*fmt && len < LOG_RECORD_SIZE - 1) {
+        if (*fmt != '%') {
+            body[len++] = *fmt++;
+            continue;
+        }
+
+        if (fmt[1] == '%') {
+            body[len++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        char spec[32] = "%";
+        size_t spec_len = 1;
+        const char* conversion = fmt + 1;
+
+        while (*conversion && strchr("-+ #0123456789.", *conversion)) {
+            if (spec_len < sizeof(spec) - 4) {
+                spec[spec_len++] = *conversion;
+            }
+            conversion++;
+        }
+        while (*conversion && strchr("hlLqjzt", *conversion)) {
+            conversion++;
+        }
+
+        if (!*conversion || !*types) {
+            body[len++] = *fmt++;
+            continue;
+        }
+
+        spec[spec_len] = '\0';
+
+        size_t written = 0;
+        if (!DecodeArg(body + len, LOG_RECORD_SIZE - len, spec, *conversion, *types++, &args, end, &written)) {
+            return false;
+        }
+
+        len += written;
+        fmt = conversion + 1;
+    }
+
+    *fits = *fmt == '\0' && len < LOG_RECORD_SIZE;
+
+    if (len >= LOG_RECORD_SIZE) {
+        len = LOG_RECORD_SIZE - 1;
+    }
+    body[len] = '\0';
+
+    return true;
+}
+
+// Strings are encoded with at most LOG_RECORD_SIZE characters, a longer one or an argument running past
+// the end of the record makes it malformed, and *args is left where it was.
+static bool DecodeArg(char* dst, size_t size, const char* spec, char conversion, char type,
+                      const char** args, const char* end, size_t* written) {
+    char format[40] = "";
+    char string[LOG_RECORD_SIZE + 1] = "";
+    uint64_t raw = 0;
+    int len = 0;
+    size_t available = (size_t) (end - *args);
+
+    if (type == 's') {
+        uint32_t string_len = 0;
+
+        if (available < sizeof(string_len)) {
+            return false;
+        }
+
+        memcpy(&string_len, *args, sizeof(string_len));
+        if (string_len > LOG_RECORD_SIZE || string_len > available - sizeof(string_len)) {
+            return false;
+        }
+
+        memcpy(string, *args + sizeof(string_len), string_len);
+        string[string_len] = '\0';
+        *args += sizeof(string_len) + string_len;
+    }
+    else {
+        if (available < sizeof(raw)) {
+            return false;
+        }
+
+        memcpy(&raw, *args, sizeof(raw));
+        *args += sizeof(raw);
+    }
+
+    double real = 0;
+    memcpy(&real, &raw, sizeof(real));
+
+    long long integer = type == 'f' ? (long long) real : (long long) raw;
+    if (type != 'f') {
+        real = type == 'i' ? (double) (int64_t) raw : (double) raw;
+    }
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wformat-nonliteral"
-    vfprintf (GetLogger()->file_out, dst, args);
+    switch (conversion) {
+        case 'd': case 'i':
+            snprintf(format, sizeof(format), "%slld", spec);
+            len = snprintf(dst, size, format, integer);
+            break;
+        case 'o': case 'u': case 'x': case 'X':
+            snprintf(format, sizeof(format), "%sll%c", spec, conversion);
+            len = snprintf(dst, size, format, (unsigned long long) integer);
+            break;
+        case 'c':
+            snprintf(format, sizeof(format), "%sc", spec);
+            len = snprintf(dst, size, format, (int) integer);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            snprintf(format, sizeof(format), "%s%c", spec, conversion);
+            len = snprintf(dst, size, format, real);
+            break;
+        case 's':
+            snprintf(format, sizeof(format), "%ss", spec);
+            len = snprintf(dst, size, format, type == 's' ? string : "(?)");
+            break;
+        case 'p':
+            snprintf(format, sizeof(format), "%sp", spec);
+            len = snprintf(dst, size, format, (void*) (uintptr_t) raw);
+            break;
+        default:
+            len = snprintf(dst, size, "%s%c", spec, conversion);
+            break;
+    }
 #pragma clang diagnostic pop
 
-    va_end (args);
+    *written = len < 0 ? 0 : (size_t) len;
+    return true;
 }
 
 //----------------------------------------------------------------------------------------------
 
+static size_t FormatRecord(char* dst, enum LogLevel status, const char* file, size_t line, const char* func,
+                           const char* fmt, va_list args) {
+    char body[LOG_RECORD_SIZE] = "";
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+    int body_len = vsnprintf(body, LOG_RECORD_SIZE, fmt, args);
+#pragma clang diagnostic pop
+
+    bool color = GetLogger()->file_out == stderr || GetLogger()->file_out == stdout;
+
+    return FormatRecord(dst, status, file, line, func, time(nullptr), body,
+                        body_len >= 0 && (size_t) body_len < LOG_RECORD_SIZE, color);
+}
+
+// The record is cut at LOG_RECORD_SIZE and then ends in TRUNCATION_MARK.
+static size_t FormatRecord(char* dst, enum LogLevel status, const char* file, size_t line, const char* func,
+                           time_t seconds, const char* body, bool body_fits, bool color) {
+    size_t len = (size_t) snprintf(dst, LOG_RECORD_SIZE, "%s:%zu (%s)\n%s", file, line, func,
+                                   LogMessageTypePrint(status, color));
+    bool fits = body_fits;
+
+    if (len < LOG_RECORD_SIZE) {
+        len += TimePrint(dst + len, LOG_RECORD_SIZE - len, seconds);
+    }
+
+    if (len < LOG_RECORD_SIZE) {
+        len += AestheticizeString(body, dst + len, LOG_RECORD_SIZE - len, &fits);
+    }
+    else {
+        fits = false;
+    }
+
+    if (len >= LOG_RECORD_SIZE) {
+        len = LOG_RECORD_SIZE - 1;
+    }
+
+    if (!fits) {
+        memcpy(dst + len - (sizeof(TRUNCATION_MARK) - 1), TRUNCATION_MARK, sizeof(TRUNCATION_MARK) - 1);
+        dst[len] = '\0';
+    }
+
+    return len;
+}
+
 #define ADD_COLOR_(COLOR , str)           \
     do {                                  \
         if (color) {                      \
@@ -89,45 +873,54 @@ static const char* LogMessageTypePrint(const enum LogLevel level, const bool col
 
 #undef ADD_COLOR_
 
-static void TimePrint(FILE *out) {
-    assert(out != nullptr);
+static size_t TimePrint(char* dst, size_t size, time_t seconds) {
+    assert(dst != nullptr);
 
-    time_t mytime = time(NULL);
-    struct tm *time = localtime(&mytime);
+    struct tm time = {};
+    localtime_r(&seconds, &time);
 
-    fprintf(out, "%02d.%02d.%d %02d:%02d:%02d ",
-            time->tm_mday, time->tm_mon + 1, time->tm_year + 1900,
-            time->tm_hour, time->tm_min,     time->tm_sec);
+    size_t len = (size_t) snprintf(dst, size, "%02d.%02d.%d %02d:%02d:%02d ",
+                                   time.tm_mday, time.tm_mon + 1, time.tm_year + 1900,
+                                   time.tm_hour, time.tm_min,     time.tm_sec);
+    return len < size ? len : size - 1;
 }
 
-static void AestheticizeString(const char *src, char *dst, const size_t max_len) {
+// Starts the message on a new line and indents each of its lines by a tab. Returns the length written;
+// *fits is cleared if src had to be cut to fit max_len bytes.
+static size_t AestheticizeString(const char *src, char *dst, const size_t max_len, bool* fits) {
     assert(src != nullptr);
     assert(dst != nullptr);
+    assert(max_len > 0);
 
-    size_t len = strnlen(src, max_len);
+    size_t j = 0;
+    dst[0] = '\0';
 
-    if (len == 0) {
-        return;
+    if (src[0] == '\0') {
+        return 0;
     }
 
-    size_t j = 0, i = 0;
+    if (max_len < 3) {
+        *fits = false;
+        return 0;
+    }
 
     dst[j++] = '\n';
     dst[j++] = '\t';
 
-    for(; i < len && j < max_len - 1; i++) {
-        if (src[i] == '\n') {
-            dst[j++] = '\n';
-            dst[j++] = '\t';
+    for (size_t i = 0; src[i] != '\0'; i++) {
+        bool indent = src[i] == '\n' && src[i + 1] != '\0';
+
+        if (j + 1 + indent >= max_len) {
+            *fits = false;
+            break;
         }
-        else {
-            dst[j++] = src[i];
+
+        dst[j++] = src[i];
+        if (indent) {
+            dst[j++] = '\t';
         }
     }
-    if (src[--i] == '\n') {
-        dst[--j] = '\0';
-    }
-    else {
-        dst[j] = '\0';
-    }
+
+    dst[j] = '\0';
+    return j;
 }
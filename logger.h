@@ -2,6 +2,12 @@
 #define LOGGER_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#include "flight_recorder.h"
 
 #define STRERROR(ERRNO) ": %s", strerror(errno)
 
@@ -12,20 +18,198 @@ enum LogLevel {
     ERROR   = 3
 };
 
+// LOG sites below this level are compiled out, arguments included: build with -DLOG_MIN_LEVEL=2 to keep
+// only warnings and errors. The runtime level set by LoggerSetLevel() filters the remaining ones.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// What a full queue does to the caller in asynchronous mode.
+enum LogOverflow {
+    LOG_OVERFLOW_DROP  = 0,  // the message is counted and dropped, the writer reports the count later
+    LOG_OVERFLOW_BLOCK = 1,  // the caller waits for a free slot
+};
+
+// A message is formatted into one record and written with a single fwrite(); longer ones are cut.
+#define LOG_RECORD_SIZE 1024
+#define LOG_DEFAULT_QUEUE_CAPACITY 1024
+
 typedef struct {
-    FILE* file_out;
+    FILE* file_out;                     // nullptr if records only go to the flight recorder
     enum LogLevel min_level;
+    flight_recorder_t flight_recorder;
 } logger_t;
 
 void Log(enum LogLevel status, const char* file, size_t line, const char* func, const char *fmt, ...);
 
-void LoggerSetFile(FILE* out);
+// The stream keeps its own buffering: records reach the file on LoggerFlush(), at exit, after every ERROR
+// record and whenever the buffer fills up. unbuffered writes every record through at once instead, for runs
+// that may crash without a flight recorder.
+void LoggerSetFile(FILE* out, bool unbuffered = false);
 
 void LoggerSetLevel(enum LogLevel level);
 
-#define LOG(status, ...)                                        \
-    do {                                                        \
-        Log(status, __FILE__, __LINE__, __func__, __VA_ARGS__); \
+// Keeps a copy of every text record in a flight recorder file of about size bytes (flight_recorder.h),
+// written at the call site even in asynchronous mode, so that the latest records survive a crash.
+// nullptr closes it. Read it back with flight_recorder_dump() or the flight_recorder_dump tool.
+bool LoggerSetFlightRecorder(const char* path, size_t size);
+
+// Asynchronous mode: Log() formats into a slot of a bounded lock-free queue and returns, a background
+// thread writes the queued records to the file in batches. The queue is flushed by LoggerFlush(), by
+// LoggerStopAsync() and at exit. A child process forked while it runs logs synchronously.
+bool LoggerStartAsync(size_t capacity, enum LogOverflow overflow);
+
+void LoggerStopAsync();
+
+// Returns once everything logged before the call is written and the file is flushed.
+void LoggerFlush();
+
+#define LOG(status, ...)                                            \
+    do {                                                            \
+        if ((status) >= LOG_MIN_LEVEL) {                            \
+            Log(status, __FILE__, __LINE__, __func__, __VA_ARGS__); \
+        }                                                           \
+    } while(0)
+
+//----------------------------------------------------------------------------------------------
+
+// Deferred binary logging. Once LoggerSetBinaryFile() is given a file, LOG_BINARY() doesn't format
+// anything: it appends the id of its call site, a timestamp and the raw arguments to a buffer of the
+// calling thread, which is written to the file when it fills up, on LoggerFlush() and at thread exit.
+// The format string, level and location of a site go to the file once, on its first use.
+// LoggerDecodeBinary() (or the log_decoder tool) renders the file as Log() would have.
+//
+// Arguments may be integers, enums, floating point numbers, C strings and pointers; '*' widths are not
+// supported. Without a binary file LOG_BINARY() is the same as LOG().
+
+#define LOG_BINARY_MAGIC "BMLOG01"
+#define LOG_BINARY_SITE 0xFFFFFFFFu
+
+typedef struct log_site_t {
+    enum LogLevel level;
+    const char* file;
+    size_t line;
+    const char* func;
+    const char* fmt;            // set on registration
+    const char* arg_types;      // one LogArgType() character per argument
+    log_site_t* next;
+    std::atomic<uint32_t> id;   // 0 until registered
+} log_site_t;
+
+typedef struct {
+    uint32_t site;
+    uint32_t size;              // of the arguments that follow
+    uint64_t timestamp;         // CLOCK_REALTIME, ns
+} log_binary_header_t;
+
+// nullptr returns LOG_BINARY() to text logging.
+bool LoggerSetBinaryFile(FILE* out);
+
+bool LoggerBinaryActive();
+
+// Renders a binary log. Returns false if it is malformed; the records before the damage are written.
+bool LoggerDecodeBinary(FILE* in, FILE* out);
+
+uint32_t LogRegisterSite(log_site_t* site, const char* fmt, const char* arg_types);
+
+// Space for the arguments of one record, or nullptr if it isn't to be written.
+char* LogBinaryReserve(const log_site_t* site, uint32_t id, size_t size);
+
+// Length of a string argument, cut at LOG_RECORD_SIZE; a null string is empty.
+uint32_t LogStringLen(const char* value);
+
+template <typename T>
+constexpr char LogArgType() {
+    if (std::is_same<T, char*>::value || std::is_same<T, const char*>::value) {
+        return 's';
+    }
+    if (std::is_pointer<T>::value || std::is_null_pointer<T>::value) {
+        return 'p';
+    }
+    if (std::is_floating_point<T>::value) {
+        return 'f';
+    }
+    if (std::is_enum<T>::value || std::is_signed<T>::value) {
+        return 'i';
+    }
+    return 'u';
+}
+
+inline size_t LogArgSize(const char* value) {
+    return sizeof(uint32_t) + LogStringLen(value);
+}
+
+// A mutable buffer would otherwise match the template exactly and be encoded as a pointer.
+inline size_t LogArgSize(char* value) {
+    return LogArgSize((const char*) value);
+}
+
+template <typename T>
+inline size_t LogArgSize(T) {
+    return sizeof(uint64_t);
+}
+
+inline void LogArgEncode(char** dst, const char* value) {
+    uint32_t len = LogStringLen(value);
+
+    memcpy(*dst, &len, sizeof(len));
+    memcpy(*dst + sizeof(len), value, len);
+    *dst += sizeof(len) + len;
+}
+
+inline void LogArgEncode(char** dst, char* value) {
+    LogArgEncode(dst, (const char*) value);
+}
+
+template <typename T>
+inline void LogArgEncode(char** dst, T value) {
+    uint64_t raw = 0;
+
+    if constexpr (std::is_floating_point<T>::value) {
+        double converted = (double) value;
+        memcpy(&raw, &converted, sizeof(raw));
+    }
+    else if constexpr (std::is_pointer<T>::value || std::is_null_pointer<T>::value) {
+        raw = (uint64_t) (uintptr_t) value;
+    }
+    else {
+        raw = (uint64_t) value;
+    }
+
+    memcpy(*dst, &raw, sizeof(raw));
+    *dst += sizeof(raw);
+}
+
+template <typename... Args>
+inline void LogBinary(log_site_t* site, const char* fmt, Args... args) {
+    if (!LoggerBinaryActive()) {
+        Log(site->level, site->file, site->line, site->func, fmt, args...);
+        return;
+    }
+
+    uint32_t id = site->id.load(std::memory_order_acquire);
+
+    if (!id) {
+        static const char arg_types[] = {LogArgType<Args>()..., '\0'};
+        id = LogRegisterSite(site, fmt, arg_types);
+    }
+
+    char* dst = LogBinaryReserve(site, id, (LogArgSize(args) + ... + 0));
+
+    if (dst == nullptr) {
+        return;
+    }
+
+    (LogArgEncode(&dst, args), ...);
+}
+
+#define LOG_BINARY(status, ...)                                                             \
+    do {                                                                                    \
+        if ((status) >= LOG_MIN_LEVEL) {                                                    \
+            static log_site_t log_site_ = {status, __FILE__, __LINE__, __func__,             \
+                                           nullptr, nullptr, nullptr, {0}};                 \
+            LogBinary(&log_site_, __VA_ARGS__);                                             \
+        }                                                                                   \
     } while(0)
 
 #endif /* LOGGER_H */
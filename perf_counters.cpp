@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "perf_counters.h"
+#include "logger.h"
+
+static int open_counter(perf_counter_t counter, int group_fd);
+static uint64_t counter_config(perf_counter_t counter, uint32_t* type);
+static uint64_t cache_config(uint64_t cache, uint64_t op, uint64_t result);
+static int perf_event_paranoid();
+
+//============================================================================================================
+
+const size_t GROUP_READ_HEADER = 3; // nr, time_enabled, time_running
+const double MPKI_SCALE = 1000;
+
+//============================================================================================================
+
+// Opens every counter this machine supports as one group led by the first of them, disabled until
+// perf_counters_enable(). Counters the PMU doesn't have (typical in VMs) are left out; with none at
+// all the benchmark runs without counters.
+bool perf_counters_open(perf_counters_t* counters) {
+    assert(counters);
+
+    counters->opened = false;
+    counters->group_fd = -1;
+
+    // Saved right away, reading perf_event_paranoid for the warning can overwrite errno.
+    int error = 0;
+
+    for (size_t i = 0; i < PERF_COUNTERS_CNT; i++) {
+        counters->fds[i] = open_counter((perf_counter_t) i, counters->group_fd);
+
+        if (counters->fds[i] < 0) {
+            error = errno;
+            continue;
+        }
+
+        if (counters->group_fd < 0) {
+            counters->group_fd = counters->fds[i];
+        }
+
+        if (ioctl(counters->fds[i], PERF_EVENT_IOC_ID, &counters->ids[i])) {
+            error = errno;
+
+            if (counters->group_fd == counters->fds[i]) {
+                counters->group_fd = -1;
+            }
+
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+
+    if (counters->group_fd < 0) {
+        static bool warned = false;
+
+        if (!warned) {
+            int paranoid = perf_event_paranoid();
+            LOG(WARNING, "Hardware counters are unavailable (perf_event_paranoid = %d): %s\n",
+                         paranoid, strerror(error));
+            warned = true;
+        }
+        return false;
+    }
+
+    counters->opened = true;
+    return true;
+}
+
+void perf_counters_close(perf_counters_t* counters) {
+    assert(counters);
+
+    if (!counters->opened) {
+        return;
+    }
+
+    // The leader is closed last, the group would be torn down under the other counters otherwise.
+    for (size_t i = 0; i < PERF_COUNTERS_CNT; i++) {
+        if (counters->fds[i] >= 0 && counters->fds[i] != counters->group_fd) {
+            close(counters->fds[i]);
+        }
+    }
+
+    close(counters->group_fd);
+
+    counters->opened = false;
+    counters->group_fd = -1;
+}
+
+void perf_counters_reset(perf_counters_t* counters) {
+    assert(counters);
+
+    if (counters->opened) {
+        ioctl(counters->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+// Counts accumulated since the last reset, scaled up if the group was multiplexed with other events,
+// and divided by the number of iterations they cover.
+void perf_counters_read(const perf_counters_t* counters, double iterations, counters_results_t* results) {
+    assert(counters);
+    assert(results);
+
+    memset(results, 0, sizeof(counters_results_t));
+
+    if (!counters->opened || iterations <= 0) {
+        return;
+    }
+
+    uint64_t values[GROUP_READ_HEADER + 2 * PERF_COUNTERS_CNT] = {};
+
+    if (read(counters->group_fd, values, sizeof(values)) < (ssize_t) (GROUP_READ_HEADER * sizeof(uint64_t))) {
+        LOG(WARNING, "Can't read hardware counters: %s\n", strerror(errno));
+        return;
+    }
+
+    uint64_t counters_cnt = values[0];
+    uint64_t time_enabled = values[1];
+    uint64_t time_running = values[2];
+
+    if (time_running == 0) {
+        LOG(WARNING, "Hardware counter group was never scheduled on the PMU\n");
+        return;
+    }
+
+    results->measured = true;
+    results->running_ratio = (double) time_running / (double) time_enabled;
+
+    for (uint64_t i = 0; i < counters_cnt && i < PERF_COUNTERS_CNT; i++) {
+        uint64_t value = values[GROUP_READ_HEADER + 2 * i];
+        uint64_t id = values[GROUP_READ_HEADER + 2 * i + 1];
+
+        for (size_t counter = 0; counter < PERF_COUNTERS_CNT; counter++) {
+            if (counters->fds[counter] >= 0 && counters->ids[counter] == id) {
+                results->available[counter] = true;
+                results->per_iteration[counter] = (double) value / results->running_ratio / iterations;
+            }
+        }
+    }
+
+    const double* per_iteration = results->per_iteration;
+    double instructions = per_iteration[COUNTER_INSTRUCTIONS];
+
+    if (results->available[COUNTER_CYCLES] && per_iteration[COUNTER_CYCLES] > 0) {
+        results->ipc = instructions / per_iteration[COUNTER_CYCLES];
+    }
+
+    if (results->available[COUNTER_INSTRUCTIONS] && instructions > 0) {
+        results->l1d_mpki = MPKI_SCALE * per_iteration[COUNTER_L1D_MISSES] / instructions;
+        results->llc_mpki = MPKI_SCALE * per_iteration[COUNTER_LLC_MISSES] / instructions;
+        results->branch_mpki = MPKI_SCALE * per_iteration[COUNTER_BRANCH_MISSES] / instructions;
+        results->dtlb_mpki = MPKI_SCALE * per_iteration[COUNTER_DTLB_MISSES] / instructions;
+    }
+}
+
+const char* perf_counter_name(perf_counter_t counter) {
+    switch (counter) {
+        case COUNTER_CYCLES:
+            return "cycles";
+        case COUNTER_INSTRUCTIONS:
+            return "instructions";
+        case COUNTER_L1D_MISSES:
+            return "l1d_misses";
+        case COUNTER_LLC_MISSES:
+            return "llc_misses";
+        case COUNTER_BRANCH_MISSES:
+            return "branch_misses";
+        case COUNTER_DTLB_MISSES:
+            return "dtlb_misses";
+        default:
+            assert(0 && "Undefined counter");
+            return "unknown";
+    }
+}
+
+//============================================================================================================
+
+// User space of the calling thread only, which is what perf_event_paranoid = 2 still allows.
+static int open_counter(perf_counter_t counter, int group_fd) {
+    struct perf_event_attr attr = {};
+
+    attr.size = sizeof(attr);
+    attr.config = counter_config(counter, &attr.type);
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static uint64_t counter_config(perf_counter_t counter, uint32_t* type) {
+    *type = PERF_TYPE_HARDWARE;
+
+    switch (counter) {
+        case COUNTER_CYCLES:
+            return PERF_COUNT_HW_CPU_CYCLES;
+        case COUNTER_INSTRUCTIONS:
+            return PERF_COUNT_HW_INSTRUCTIONS;
+        case COUNTER_LLC_MISSES:
+            return PERF_COUNT_HW_CACHE_MISSES;
+        case COUNTER_BRANCH_MISSES:
+            return PERF_COUNT_HW_BRANCH_MISSES;
+        case COUNTER_L1D_MISSES:
+            *type = PERF_TYPE_HW_CACHE;
+            return cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+        case COUNTER_DTLB_MISSES:
+            *type = PERF_TYPE_HW_CACHE;
+            return cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+        default:
+            assert(0 && "Undefined counter");
+            return 0;
+    }
+}
+
+static uint64_t cache_config(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+static int perf_event_paranoid() {
+    FILE* file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    if (!file) {
+        return -1;
+    }
+
+    int paranoid = -1;
+    if (fscanf(file, "%d", &paranoid) != 1) {
+        paranoid = -1;
+    }
+
+    fclose(file);
+    return paranoid;
+}
@@ -0,0 +1,57 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+typedef enum {
+    COUNTER_CYCLES        = 0,
+    COUNTER_INSTRUCTIONS  = 1,
+    COUNTER_L1D_MISSES    = 2,
+    COUNTER_LLC_MISSES    = 3,
+    COUNTER_BRANCH_MISSES = 4,
+    COUNTER_DTLB_MISSES   = 5,
+} perf_counter_t;
+
+#define PERF_COUNTERS_CNT 6
+
+typedef struct {
+    bool opened;
+    int group_fd;
+    int fds[PERF_COUNTERS_CNT];
+    uint64_t ids[PERF_COUNTERS_CNT];
+} perf_counters_t;
+
+typedef struct {
+    bool measured;
+    bool available[PERF_COUNTERS_CNT];
+    double per_iteration[PERF_COUNTERS_CNT];
+    double running_ratio;  // share of the enabled time the group was on the PMU
+
+    double ipc;
+    double l1d_mpki;       // misses per 1000 instructions
+    double llc_mpki;
+    double branch_mpki;
+    double dtlb_mpki;
+} counters_results_t;
+
+bool perf_counters_open(perf_counters_t* counters);
+void perf_counters_close(perf_counters_t* counters);
+
+void perf_counters_reset(perf_counters_t* counters);
+void perf_counters_read(const perf_counters_t* counters, double iterations, counters_results_t* results);
+
+const char* perf_counter_name(perf_counter_t counter);
+
+// Counting is switched on and off around every timed sample, so these are kept inline.
+inline void perf_counters_enable(const perf_counters_t* counters) {
+    ioctl(counters->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+inline void perf_counters_disable(const perf_counters_t* counters) {
+    ioctl(counters->group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+#endif /* PERF_COUNTERS_H */
@@ -1,16 +1,20 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "queue.h"
+#include "logger.h"
 
-error_t cb_ctor(circ_buffer_t* circ_buffer, size_t capacity, size_t elm_width) {
+cb_err_t cb_ctor(circ_buffer_t* circ_buffer, size_t capacity, size_t elm_width) {
     if (!capacity) {
         return NULL_CAPACITY_ERROR;
     }
 
     circ_buffer->buffer_holder = new_vector(elm_width);
-    vector_reserve(circ_buffer->buffer_holder, capacity);
+    if (!circ_buffer->buffer_holder || vector_reserve_elms(circ_buffer->buffer_holder, capacity) != OK) {
+        return MEM_ALLOCATION_ERROR;
+    }
 
     circ_buffer->head = circ_buffer->buffer_holder->data;
     circ_buffer->tail = circ_buffer->buffer_holder->data;
@@ -30,8 +34,8 @@ void cb_push(circ_buffer_t* circ_buffer, void* elm) {
     assert(circ_buffer);
     assert(elm);
 
-    vector_push_back(circ_buffer->buffer_holder, elm);
-    circ_buffer->head = vector_head_ptr(circ_buffer->buffer_holder);
+    memcpy(circ_buffer->head, elm, circ_buffer->buffer_holder->elm_width);
+    circ_buffer->head = (char*)circ_buffer->head + circ_buffer->buffer_holder->elm_width;
 
     if ((size_t) circ_buffer->head == (size_t) circ_buffer->buffer_holder->data +
         circ_buffer->buffer_holder->capacity * circ_buffer->buffer_holder->elm_width) {
@@ -51,3 +55,52 @@ void cb_pop(circ_buffer_t* circ_buffer, void* elm) {
         circ_buffer->tail = vector_tail_ptr(circ_buffer->buffer_holder);
     }
 }
+
+//============================================================================================================
+
+cb_err_t spsc_ring_ctor(spsc_ring_t* ring, size_t capacity, size_t elm_width, arena_t* arena) {
+    assert(ring);
+
+    if (!elm_width) {
+        return NULL_ELM_WIDTH_ERROR;
+    }
+    if (!capacity) {
+        return NULL_CAPACITY_ERROR;
+    }
+
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    size_t bytes = (rounded * elm_width + CACHE_LINE_SIZE - 1) & ~(size_t) (CACHE_LINE_SIZE - 1);
+
+    ring->data = (char*) (arena ? arena_alloc(arena, bytes, CACHE_LINE_SIZE) : aligned_alloc(CACHE_LINE_SIZE, bytes));
+    if (!ring->data) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return MEM_ALLOCATION_ERROR;
+    }
+
+    ring->mask = rounded - 1;
+    ring->elm_width = elm_width;
+    ring->arena = arena;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+    return NO_ERRORS;
+}
+
+void spsc_ring_dtor(spsc_ring_t* ring) {
+    assert(ring);
+
+    if (!ring->arena) {
+        free(ring->data);
+    }
+
+    ring->data = nullptr;
+    ring->arena = nullptr;
+    ring->mask = 0;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+}
@@ -2,8 +2,13 @@
 #define CIRCULAR_BUFFER_H
 
 #include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "arena.h"
 #include "vector.h"
 
+#define CACHE_LINE_SIZE 64
+
 typedef struct {
     vector_t* buffer_holder;
     //size_t size;
@@ -18,12 +23,78 @@ typedef enum {
     NULL_CAPACITY_ERROR     = 1 << 2, // 0x0002
     MEM_ALLOCATION_ERROR = 1 << 3, // 0x0004
     FULL_BUFFER             = 1 << 4, // 0x0008
-} error_t;
+} cb_err_t;
 
-error_t cb_ctor(circ_buffer_t* circ_buffer, size_t capacity, size_t elm_width);
+cb_err_t cb_ctor(circ_buffer_t* circ_buffer, size_t capacity, size_t elm_width);
 void cb_dtor(circ_buffer_t* circ_buffer);
 
 void cb_push(circ_buffer_t* circ_buffer, void* elm);
 void cb_pop(circ_buffer_t* circ_buffer, void* elm);
 
+//============================================================================================================
+
+// Fixed-capacity single-producer / single-consumer ring. The capacity is rounded up to a power of two, so
+// the positions only ever grow and are masked on access. Each side keeps its own position and a cached copy
+// of the other one on its own cache line, and reads the other side's position (acquire) only when the
+// cached copy says the ring is full or empty.
+typedef struct {
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;  // written by the producer
+    size_t cached_tail;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;  // written by the consumer
+    size_t cached_head;
+
+    alignas(CACHE_LINE_SIZE) char* data;
+    size_t mask;
+    size_t elm_width;
+    arena_t* arena;
+} spsc_ring_t;
+
+// With an arena the slots are taken from it and left there by spsc_ring_dtor().
+cb_err_t spsc_ring_ctor(spsc_ring_t* ring, size_t capacity, size_t elm_width, arena_t* arena = nullptr);
+void spsc_ring_dtor(spsc_ring_t* ring);
+
+// Producer side. Returns false if the ring is full.
+inline bool spsc_ring_push(spsc_ring_t* ring, const void* elm) {
+    size_t head = ring->head.load(std::memory_order_relaxed);
+
+    if (head - ring->cached_tail > ring->mask) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+
+        if (head - ring->cached_tail > ring->mask) {
+            return false;
+        }
+    }
+
+    memcpy(ring->data + (head & ring->mask) * ring->elm_width, elm, ring->elm_width);
+    ring->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Consumer side. Returns false if the ring is empty.
+inline bool spsc_ring_pop(spsc_ring_t* ring, void* elm) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+    if (tail == ring->cached_head) {
+        ring->cached_head = ring->head.load(std::memory_order_acquire);
+
+        if (tail == ring->cached_head) {
+            return false;
+        }
+    }
+
+    memcpy(elm, ring->data + (tail & ring->mask) * ring->elm_width, ring->elm_width);
+    ring->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Exact only when called from one of the two sides while the other one is idle.
+inline size_t spsc_ring_size(const spsc_ring_t* ring) {
+    return ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+}
+
+inline size_t spsc_ring_capacity(const spsc_ring_t* ring) {
+    return ring->mask + 1;
+}
+
 #endif /* CIRCULAR_BUFFER_H */
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <math.h>
+
+#include "regression.h"
+#include "logger.h"
+
+typedef struct {
+    char name[256];
+    char units[16];
+    size_t size;
+    double mean;
+    double stddev;
+    double median;
+    size_t saved_cnt;
+    double* samples;
+} baseline_entry_t;
+
+static const benchmark_t* find_result(const char* name);
+static bool contains(const vector<const benchmark_t*>* compared, const benchmark_t* bm);
+static size_t subsample(const samples_t* samples, double* dst, size_t max_cnt);
+static void batch_means(const double* samples, size_t size, statistics_t* stats);
+static bool read_entry(FILE* file, baseline_entry_t* entry, bool* damaged);
+static verdict_t compare_entry(const baseline_entry_t* entry, const benchmark_t* bm,
+                               const compare_config_t* config, double* change, double* p_value);
+
+//============================================================================================================
+
+const char* const BASELINE_HEADER = "benchmark_lib-baseline";
+const int BASELINE_VERSION = 1;
+const size_t BASELINE_SAMPLES = 1000;
+const size_t COMPARE_BATCHES = 20;
+
+//============================================================================================================
+
+bool baseline_save(const char* path) {
+    assert(path);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOG(ERROR, "Can't open baseline file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+
+    double saved[BASELINE_SAMPLES] = {};
+
+    fprintf(file, "%s %d\n", BASELINE_HEADER, BASELINE_VERSION);
+
+    for (const benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        const statistics_t* stats = &bm->testing_results.stats;
+        if (!stats->size) {
+            continue;
+        }
+
+        size_t saved_cnt = subsample(&bm->samples, saved, BASELINE_SAMPLES);
+
+        fprintf(file, "%s %s %zu %.17g %.17g %.17g %zu\n", bm->name, timer_backend_units(bm->timer),
+                      stats->size, stats->mean, stats->stddev, stats->median, saved_cnt);
+
+        for (size_t i = 0; i < saved_cnt; i++) {
+            fprintf(file, "%.17g%c", saved[i], i + 1 == saved_cnt ? '\n' : ' ');
+        }
+    }
+
+    if (fclose(file)) {
+        LOG(ERROR, "Can't write baseline file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+// Returns the number of benchmarks that got slower, or -1 if the baseline can't be read or is damaged.
+long baseline_compare(const char* path, const compare_config_t* config, FILE* out) {
+    assert(path);
+    assert(config);
+    assert(out);
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        LOG(ERROR, "Can't open baseline file \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char header[64] = "";
+    int version = 0;
+    if (fscanf(file, "%63s %d", header, &version) != 2 || strcmp(header, BASELINE_HEADER) ||
+        version != BASELINE_VERSION) {
+        LOG(ERROR, "\"%s\" is not a baseline file\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    double samples[BASELINE_SAMPLES] = {};
+    baseline_entry_t entry = {};
+    entry.samples = samples;
+
+    vector<const benchmark_t*> compared;
+    long regressions_cnt = 0;
+    bool damaged = false;
+
+    fprintf(out, "\n-----------Comparison with baseline------------\n\n");
+    fprintf(out, "\t[Test]: %s, alpha = %g, threshold = %g%%\n\n",
+                 config->test == COMPARE_WELCH ? "Welch's t-test" : "Mann-Whitney U",
+                 config->alpha, config->threshold * 100);
+
+    while (read_entry(file, &entry, &damaged)) {
+        const benchmark_t* bm = find_result(entry.name);
+
+        double change = 0;
+        double p_value = 1;
+        verdict_t verdict = VERDICT_MISSING;
+
+        if (!bm) {
+            fprintf(out, "\t[%s]: %s\n", entry.name, verdict_name(verdict));
+            continue;
+        }
+
+        compared.push_back(bm);
+
+        if (strcmp(entry.units, timer_backend_units(bm->timer))) {
+            fprintf(out, "\t[%s]: %s (baseline in %s, run in %s)\n", entry.name, verdict_name(verdict),
+                         entry.units, timer_backend_units(bm->timer));
+            continue;
+        }
+
+        verdict = compare_entry(&entry, bm, config, &change, &p_value);
+        regressions_cnt += verdict == VERDICT_SLOWER;
+
+        fprintf(out, "\t[%s]: %s, %+.2f%% (p = %.4g)\n", entry.name, verdict_name(verdict), change * 100, p_value);
+    }
+
+    for (const benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        if (bm->testing_results.stats.size && !contains(&compared, bm)) {
+            fprintf(out, "\t[%s]: %s\n", bm->name, verdict_name(VERDICT_NEW));
+        }
+    }
+
+    fprintf(out, "\n\t[Regressions]: %ld\n", regressions_cnt);
+    if (damaged) {
+        fprintf(out, "\t[Baseline]: damaged, the entries after the last one listed weren't compared\n");
+    }
+    fprintf(out, "\n-----------------------------------------------\n");
+
+    fclose(file);
+    return damaged ? -1 : regressions_cnt;
+}
+
+bool set_compare_test(compare_config_t* config, const char* name) {
+    assert(config);
+    assert(name);
+
+    if (!strcmp(name, "welch")) {
+        config->test = COMPARE_WELCH;
+    }
+    else if (!strcmp(name, "mann-whitney")) {
+        config->test = COMPARE_MANN_WHITNEY;
+    }
+    else {
+        LOG(ERROR, "Unknown comparison test \"%s\"\n", name);
+        return false;
+    }
+
+    return true;
+}
+
+const char* verdict_name(verdict_t verdict) {
+    switch (verdict) {
+        case VERDICT_SAME:
+            return "no significant change";
+        case VERDICT_FASTER:
+            return "faster";
+        case VERDICT_SLOWER:
+            return "slower";
+        case VERDICT_MISSING:
+            return "not compared";
+        case VERDICT_NEW:
+            return "new, not in the baseline";
+        default:
+            assert(0 && "Undefined verdict");
+            return "unknown";
+    }
+}
+
+//============================================================================================================
+
+static const benchmark_t* find_result(const char* name) {
+    for (const benchmark_t* bm = registry()->head; bm; bm = bm->next) {
+        if (!strcmp(bm->name, name) && bm->testing_results.stats.size) {
+            return bm;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool contains(const vector<const benchmark_t*>* compared, const benchmark_t* bm) {
+    for (const benchmark_t* entry : *compared) {
+        if (entry == bm) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Evenly strided subset, so that both sides of a rank test have comparable sizes.
+static size_t subsample(const samples_t* samples, double* dst, size_t max_cnt) {
+    size_t cnt = samples->size < max_cnt ? samples->size : max_cnt;
+
+    for (size_t i = 0; i < cnt; i++) {
+        dst[i] = samples->data[i * samples->size / cnt];
+    }
+
+    return cnt;
+}
+
+// Per-sample times are autocorrelated, so a t-test on them finds "significant" changes in pure noise.
+// The means of consecutive batches are close to independent.
+static void batch_means(const double* samples, size_t size, statistics_t* stats) {
+    double means[COMPARE_BATCHES] = {};
+    size_t batches_cnt = size < COMPARE_BATCHES ? size : COMPARE_BATCHES;
+
+    for (size_t batch = 0; batch < batches_cnt; batch++) {
+        size_t begin = batch * size / batches_cnt;
+        size_t end = (batch + 1) * size / batches_cnt;
+
+        double sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            sum += samples[i];
+        }
+        means[batch] = sum / (double) (end - begin);
+    }
+
+    compute_statistics(means, batches_cnt, stats, false);
+}
+
+// Returns false at the end of the file, and also sets *damaged if an entry is malformed or cut short.
+static bool read_entry(FILE* file, baseline_entry_t* entry, bool* damaged) {
+    int fields_cnt = fscanf(file, "%255s %15s %zu %lf %lf %lf %zu", entry->name, entry->units, &entry->size,
+                            &entry->mean, &entry->stddev, &entry->median, &entry->saved_cnt);
+    if (fields_cnt == EOF) {
+        return false;
+    }
+
+    if (fields_cnt != 7) {
+        LOG(ERROR, "Malformed baseline entry\n");
+        *damaged = true;
+        return false;
+    }
+
+    if (entry->saved_cnt > BASELINE_SAMPLES) {
+        LOG(ERROR, "Baseline of \"%s\" has too many samples\n", entry->name);
+        *damaged = true;
+        return false;
+    }
+
+    for (size_t i = 0; i < entry->saved_cnt; i++) {
+        if (fscanf(file, "%lf", &entry->samples[i]) != 1) {
+            LOG(ERROR, "Baseline of \"%s\" is truncated\n", entry->name);
+            *damaged = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static verdict_t compare_entry(const baseline_entry_t* entry, const benchmark_t* bm,
+                               const compare_config_t* config, double* change, double* p_value) {
+    const statistics_t* stats = &bm->testing_results.stats;
+
+    double current[BASELINE_SAMPLES] = {};
+    size_t current_cnt = subsample(&bm->samples, current, BASELINE_SAMPLES);
+
+    if (config->test == COMPARE_WELCH) {
+        statistics_t current_batches = {};
+        statistics_t baseline_batches = {};
+        batch_means(current, current_cnt, &current_batches);
+        batch_means(entry->samples, entry->saved_cnt, &baseline_batches);
+
+        *p_value = welch_t_test(current_batches.mean, current_batches.stddev, current_batches.size,
+                                baseline_batches.mean, baseline_batches.stddev, baseline_batches.size);
+        *change = entry->mean > 0 ? stats->mean / entry->mean - 1 : 0;
+    }
+    else {
+        *p_value = mann_whitney_u_test(current, current_cnt, entry->samples, entry->saved_cnt);
+        *change = entry->median > 0 ? stats->median / entry->median - 1 : 0;
+    }
+
+    if (*p_value >= config->alpha || fabs(*change) <= config->threshold) {
+        return VERDICT_SAME;
+    }
+
+    return *change > 0 ? VERDICT_SLOWER : VERDICT_FASTER;
+}
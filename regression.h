@@ -0,0 +1,33 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <stdio.h>
+
+#include "benchmark.h"
+
+typedef enum {
+    COMPARE_WELCH        = 0,
+    COMPARE_MANN_WHITNEY = 1,
+} compare_test_t;
+
+typedef enum {
+    VERDICT_SAME    = 0,
+    VERDICT_FASTER  = 1,
+    VERDICT_SLOWER  = 2,
+    VERDICT_MISSING = 3,
+    VERDICT_NEW     = 4,
+} verdict_t;
+
+typedef struct {
+    compare_test_t test;
+    double alpha;
+    double threshold;
+} compare_config_t;
+
+bool baseline_save(const char* path);
+long baseline_compare(const char* path, const compare_config_t* config, FILE* out);
+
+bool set_compare_test(compare_config_t* config, const char* name);
+const char* verdict_name(verdict_t verdict);
+
+#endif /* REGRESSION_H */
@@ -0,0 +1,876 @@
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <math.h>
+
+#include "reporter.h"
+#include "logger.h"
+
+static report_config_t* report_config();
+static FILE* report_out();
+static const reporter_t* reporter(report_format_t format);
+
+static void console_begin(FILE* out);
+static void console_report(FILE* out, const benchmark_t* bm, size_t index);
+static void console_complexity(FILE* out, const benchmark_t* family, size_t index);
+static void console_scaling(FILE* out, const benchmark_t* family, size_t index);
+static void console_end(FILE* out);
+
+static void json_begin(FILE* out);
+static void json_report(FILE* out, const benchmark_t* bm, size_t index);
+static void json_complexity(FILE* out, const benchmark_t* family, size_t index);
+static void json_scaling(FILE* out, const benchmark_t* family, size_t index);
+static void json_end(FILE* out);
+
+static void csv_begin(FILE* out);
+static void csv_report(FILE* out, const benchmark_t* bm, size_t index);
+static void csv_complexity(FILE* out, const benchmark_t* family, size_t index);
+static void csv_scaling(FILE* out, const benchmark_t* family, size_t index);
+static void csv_end(FILE* out);
+
+static void console_environment(FILE* out, const environment_t* env);
+static void json_environment(FILE* out, const environment_t* env);
+static void csv_environment(FILE* out, const environment_t* env);
+
+static void console_counters(FILE* out, const counters_results_t* counters);
+static void json_counters(FILE* out, const counters_results_t* counters);
+static void csv_counters(FILE* out, const counters_results_t* counters);
+
+static double scale_value(double value, double base, const char** prefix);
+static const char* user_counter_kind_name(user_counter_kind_t kind);
+
+static void json_string(FILE* out, const char* str);
+static void json_number(FILE* out, double value);
+static void csv_string(FILE* out, const char* str);
+
+//============================================================================================================
+
+const double NS_PER_SEC = 1e9;
+const double REPORTED_PERCENTILES[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+const char* const REPORTED_PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+const size_t REPORTED_PERCENTILES_CNT = sizeof(REPORTED_PERCENTILES) / sizeof(REPORTED_PERCENTILES[0]);
+const double BINARY_BASE = 1024;
+const double DECIMAL_BASE = 1000;
+const char* const BINARY_PREFIXES[] = {"", "Ki", "Mi", "Gi", "Ti", "Pi"};
+const char* const DECIMAL_PREFIXES[] = {"", "k", "M", "G", "T", "P"};
+const size_t PREFIXES_CNT = sizeof(DECIMAL_PREFIXES) / sizeof(DECIMAL_PREFIXES[0]);
+
+//============================================================================================================
+
+static report_config_t* report_config() {
+    static report_config_t config = {REPORT_CONSOLE, nullptr, 0};
+    return &config;
+}
+
+static FILE* report_out() {
+    return report_config()->out ? report_config()->out : stdout;
+}
+
+static const reporter_t* reporter(report_format_t format) {
+    static const reporter_t console = {console_begin, console_report, console_complexity, console_scaling, console_end};
+    static const reporter_t json    = {json_begin,    json_report,    json_complexity,    json_scaling,    json_end};
+    static const reporter_t csv     = {csv_begin,     csv_report,     csv_complexity,     csv_scaling,     csv_end};
+
+    switch (format) {
+        case REPORT_JSON:
+            return &json;
+        case REPORT_CSV:
+            return &csv;
+        case REPORT_CONSOLE:
+            return &console;
+        default:
+            assert(0 && "Undefined report format");
+            return &console;
+    }
+}
+
+void set_reporter(report_format_t format) {
+    report_config()->format = format;
+}
+
+bool set_report_format(const char* name) {
+    assert(name);
+
+    if (!strcmp(name, "console")) {
+        set_reporter(REPORT_CONSOLE);
+    }
+    else if (!strcmp(name, "json")) {
+        set_reporter(REPORT_JSON);
+    }
+    else if (!strcmp(name, "csv")) {
+        set_reporter(REPORT_CSV);
+    }
+    else {
+        LOG(ERROR, "Unknown report format \"%s\"\n", name);
+        return false;
+    }
+
+    return true;
+}
+
+bool set_report_file(const char* path) {
+    if (report_config()->out) {
+        fclose(report_config()->out);
+        report_config()->out = nullptr;
+    }
+
+    if (!path) {
+        return true;
+    }
+
+    report_config()->out = fopen(path, "w");
+    if (!report_config()->out) {
+        LOG(ERROR, "Can't open report file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+// Where human-readable output that accompanies the report goes: stdout, unless a JSON or CSV report is
+// written there.
+FILE* report_text_stream() {
+    if (report_config()->format != REPORT_CONSOLE && !report_config()->out) {
+        return stderr;
+    }
+
+    return stdout;
+}
+
+//============================================================================================================
+
+void report_begin() {
+    report_config()->reported_cnt = 0;
+    reporter(report_config()->format)->begin(report_out());
+}
+
+void report_benchmark(const benchmark_t* bm) {
+    assert(bm);
+
+    reporter(report_config()->format)->report(report_out(), bm, report_config()->reported_cnt++);
+}
+
+void report_complexity(const benchmark_t* family) {
+    assert(family);
+
+    reporter(report_config()->format)->complexity(report_out(), family, report_config()->reported_cnt++);
+}
+
+void report_scaling(const benchmark_t* family) {
+    assert(family);
+
+    reporter(report_config()->format)->scaling(report_out(), family, report_config()->reported_cnt++);
+}
+
+void report_end() {
+    reporter(report_config()->format)->end(report_out());
+    fflush(report_out());
+}
+
+void print_report() {
+    console_report(stdout, benchmark(), 0);
+}
+
+//============================================================================================================
+
+static void console_begin(FILE*) {}
+
+static void console_report(FILE* out, const benchmark_t* bm, size_t) {
+    assert(out);
+    assert(bm);
+
+    const char* units = timer_backend_units(bm->timer);
+    const testing_results_t* results = &bm->testing_results;
+
+    fprintf(out, "\n-------------Testing results--------------\n\n");
+
+    fprintf(out, "\t[Benchmark]: %s\n", bm->name);
+    fprintf(out, "\t[Timer]: %s\n", timer_backend_name(bm->timer));
+    fprintf(out, "\t[Testing time]: %f\n\t[Tests amount]: %zu\n"
+                 "\t[Iterations per test]: %zu\n"
+                 "\t[Test avarage time]: %f %s\n\t[Avarage relative deviation]: = %2.2f%%\n\n",
+                 (double) results->time * bm->ns_per_tick / NS_PER_SEC,
+                 results->tests_cnt,
+                 results->iterations,
+                 results->average_time, units,
+                 results->average_relative_deviation * 100);
+
+    fprintf(out, "\t[Baseline per iteration]: %f %s%s\n\t[Timer overhead per test]: %f %s\n"
+                 "\t[Pause overhead per pause]: %f %s\n\n",
+                 results->baseline, units,
+                 results->baseline_subtracted ? " (subtracted)" : "",
+                 results->timer_overhead, units,
+                 results->pause_overhead, units);
+
+    if (results->clamped_samples) {
+        fprintf(out, "\t[Samples clamped to 0 by pauses]: %zu\n\n", results->clamped_samples);
+    }
+
+    if (results->threads > 1) {
+        fprintf(out, "\t[Threads]: %zu\n\t[Wall time per iteration]: %f %s\n"
+                     "\t[Thread time per iteration]: %f .. %f %s\n",
+                     results->threads, results->average_time, units,
+                     results->thread_time_min, results->thread_time_max, units);
+    }
+    fprintf(out, "\t[Throughput]: %f iterations/s\n", results->throughput);
+
+    const char* prefix = nullptr;
+    double value = 0;
+
+    if (results->bytes_per_second > 0) {
+        value = scale_value(results->bytes_per_second, BINARY_BASE, &prefix);
+        fprintf(out, "\t[Bytes processed]: %.3f %sB/s\n", value, prefix);
+    }
+
+    if (results->items_per_second > 0) {
+        value = scale_value(results->items_per_second, DECIMAL_BASE, &prefix);
+        fprintf(out, "\t[Items processed]: %.3f%s items/s\n", value, prefix);
+    }
+
+    for (size_t i = 0; i < results->user_counters_cnt; i++) {
+        const user_counter_t* counter = &results->user_counters[i];
+        value = scale_value(counter->value, DECIMAL_BASE, &prefix);
+
+        fprintf(out, "\t[%s]: %.3f%s%s\n", counter->name, value, prefix,
+                     counter->kind == USER_COUNTER_RATE    ? "/s" :
+                     counter->kind == USER_COUNTER_AVERAGE ? " per iteration" : "");
+    }
+
+    fprintf(out, "\n");
+
+    const statistics_t* stats = &results->stats;
+
+    fprintf(out, "----------Statistics per iteration-------\n\n");
+    fprintf(out, "\t[Samples retained]: %zu of %llu\n"
+                 "\t[Min]: %f %s\n\t[Median]: %f %s\n\t[P90]: %f %s\n\t[P99]: %f %s\n"
+                 "\t[P99.9]: %f %s\n\t[Max]: %f %s\n"
+                 "\t[Mean]: %f %s\n\t[Standard deviation]: %f %s\n\t[MAD]: %f %s\n"
+                 "\t[Outliers (1.5 IQR)]: %zu low, %zu high\n"
+                 "\t[Mean %2.0f%% CI]: [%f, %f] %s\n\t[Median %2.0f%% CI]: [%f, %f] %s\n\n",
+                 stats->size, (unsigned long long) bm->histogram.total,
+                 stats->min, units, stats->median, units, stats->p90, units, stats->p99, units,
+                 stats->p999, units, stats->max, units,
+                 stats->mean, units, stats->stddev, units, stats->mad, units,
+                 stats->outliers_low, stats->outliers_high,
+                 stats->confidence_level * 100, stats->mean_ci_low, stats->mean_ci_high, units,
+                 stats->confidence_level * 100, stats->median_ci_low, stats->median_ci_high, units);
+
+    if (results->counters.measured) {
+        console_counters(out, &results->counters);
+    }
+
+    if (results->allocations.measured) {
+        const allocations_results_t* allocations = &results->allocations;
+
+        fprintf(out, "---------Allocations per iteration--------\n\n");
+        fprintf(out, "\t[Allocations]: %f\n\t[Frees]: %f\n\t[Bytes allocated]: %f\n\t[Peak live bytes]: %lld\n\n",
+                     allocations->allocations, allocations->frees, allocations->bytes,
+                     (long long) allocations->peak_live_bytes);
+    }
+
+    if (results->precision.measured) {
+        const precision_results_t* precision = &results->precision;
+
+        fprintf(out, "---------------Precision------------------\n\n");
+        fprintf(out, "\t[%s %2.0f%% CI]: %f +- %f %s\n\t[Achieved precision]: %2.2f%% (target %2.2f%%, %s)\n"
+                     "\t[Samples]: %zu\n\n",
+                     bm->precision.statistic == PRECISION_MEDIAN ? "Median" : "Mean",
+                     bm->precision.confidence * 100, precision->estimate, precision->half_width, units,
+                     precision->relative * 100, bm->precision.target * 100,
+                     precision->reached ? "reached" : "not reached", precision->samples);
+    }
+
+    if (results->repetitions.repetitions) {
+        const repetitions_results_t* repetitions = &results->repetitions;
+
+        fprintf(out, "--------------Repetitions-----------------\n\n");
+        fprintf(out, "\t[Repetitions]: %zu of %zu\n\t[Mean]: %f %s\n\t[Median]: %f %s\n"
+                     "\t[Standard deviation]: %f %s\n\t[Min]: %f %s\n\t[Max]: %f %s\n\t[Average times]:",
+                     repetitions->repetitions, bm->repetitions, repetitions->mean, units,
+                     repetitions->median, units, repetitions->stddev, units,
+                     repetitions->min, units, repetitions->max, units);
+        for (size_t i = 0; i < repetitions->repetitions; i++) {
+            fprintf(out, " %f", bm->repetition_times[i]);
+        }
+        fprintf(out, " %s\n\n", units);
+    }
+
+    const histogram_t* histogram = &bm->histogram;
+
+    fprintf(out, "-----Streaming histogram per iteration----\n\n");
+    fprintf(out, "\t[Samples]: %llu\n", (unsigned long long) histogram->total);
+    for (size_t i = 0; i < REPORTED_PERCENTILES_CNT; i++) {
+        fprintf(out, "\t[%s]: %f %s\n", REPORTED_PERCENTILE_NAMES[i],
+                     histogram_percentile(histogram, REPORTED_PERCENTILES[i]), units);
+    }
+
+    fprintf(out, "\n----------------Warmup-------------------\n\n");
+    fprintf(out, "\t[Warmup wall time]: %f\n\t[Warmup tests amount]: %zu\n",
+                 (double) bm->warmup_results.time * bm->ns_per_tick / NS_PER_SEC,
+                 bm->warmup_results.tests_cnt);
+
+    const warmup_results_t* warmup = &bm->warmup_results;
+    if (warmup->stabilized) {
+        fprintf(out, "\t[Steady state]: after %zu tests, %zu iterations\n",
+                     warmup->stable_tests, warmup->stable_iterations);
+    }
+    else if (warmup->steady_state) {
+        fprintf(out, "\t[Steady state]: not reached, stopped at the maximum warmup time\n");
+    }
+
+    if (bm->environment.checked) {
+        console_environment(out, &bm->environment);
+    }
+
+    fprintf(out, "\n----------------------------------------\n");
+}
+
+static void console_counters(FILE* out, const counters_results_t* counters) {
+    fprintf(out, "-------Hardware counters per iteration-----\n\n");
+
+    for (size_t i = 0; i < PERF_COUNTERS_CNT; i++) {
+        if (counters->available[i]) {
+            fprintf(out, "\t[%s]: %f\n", perf_counter_name((perf_counter_t) i), counters->per_iteration[i]);
+        }
+        else {
+            fprintf(out, "\t[%s]: unavailable\n", perf_counter_name((perf_counter_t) i));
+        }
+    }
+
+    fprintf(out, "\t[IPC]: %f\n\t[L1D MPKI]: %f\n\t[LLC MPKI]: %f\n\t[Branch MPKI]: %f\n\t[dTLB MPKI]: %f\n",
+                 counters->ipc, counters->l1d_mpki, counters->llc_mpki, counters->branch_mpki, counters->dtlb_mpki);
+
+    if (counters->running_ratio < 1) {
+        fprintf(out, "\t[Multiplexed]: counted %2.1f%% of the time, values are scaled\n",
+                     counters->running_ratio * 100);
+    }
+
+    fprintf(out, "\n");
+}
+
+static void console_environment(FILE* out, const environment_t* env) {
+    fprintf(out, "\n--------------Environment----------------\n\n");
+    fprintf(out, "\t[CPU]: %d%s\n\t[Nice]: %d%s\n", env->cpu, env->pinned ? " (pinned)" : "",
+                 env->nice, env->priority_raised ? " (raised)" : "");
+    fprintf(out, "\t[Governor]: %s\n", env->governor[0] ? env->governor : "unknown");
+
+    if (env->cur_freq > 0) {
+        fprintf(out, "\t[Frequency]: %ld MHz (%ld .. %ld MHz)\n",
+                     env->cur_freq / 1000, env->min_freq / 1000, env->max_freq / 1000);
+    }
+    else {
+        fprintf(out, "\t[Frequency]: unknown\n");
+    }
+
+    fprintf(out, "\t[Turbo]: %s\n", env->turbo < 0 ? "unknown" : env->turbo ? "enabled" : "disabled");
+    fprintf(out, "\t[SMT siblings]: %s\n", env->smt_siblings[0] ? env->smt_siblings : "unknown");
+
+    for (size_t i = 0; i < ENVIRONMENT_WARNINGS_CNT; i++) {
+        if (env->warnings & (1u << i)) {
+            fprintf(out, "\t[Warning]: %s\n", environment_warning_name((environment_warning_t) (1u << i)));
+        }
+    }
+}
+
+static void console_complexity(FILE* out, const benchmark_t* family, size_t) {
+    assert(out);
+    assert(family);
+
+    const complexity_fit_t* fit = &family->complexity_fit;
+
+    fprintf(out, "\n----------------Complexity----------------\n\n");
+    fprintf(out, "\t[Benchmark]: %s\n\t[Points]: %zu\n\t[Best fit]: %s\n"
+                 "\t[Coefficient]: %f %s\n\t[RMS]: %2.2f%%\n",
+                 family->name, fit->points_cnt, complexity_name(fit->complexity),
+                 fit->coefficient, timer_backend_units(family->timer), fit->rms * 100);
+    fprintf(out, "\n----------------------------------------\n");
+}
+
+static void console_scaling(FILE* out, const benchmark_t* family, size_t) {
+    assert(out);
+    assert(family);
+
+    fprintf(out, "\n-----------------Scaling------------------\n\n");
+    fprintf(out, "\t[Benchmark]: %s\n\n", family->name);
+    fprintf(out, "\t%-40s %8s %16s %10s %10s\n", "Instance", "Threads", "Iterations/s", "Speedup", "Efficiency");
+
+    for (const benchmark_t* instance = family->next; instance && instance->family == family;
+         instance = instance->next) {
+        const testing_results_t* results = &instance->testing_results;
+        if (!results->tests_cnt) {
+            continue;
+        }
+
+        fprintf(out, "\t%-40s %8zu %16.1f %9.2fx %9.1f%%\n", instance->name, results->threads,
+                     results->throughput, results->speedup, results->efficiency * 100);
+    }
+
+    fprintf(out, "\n----------------------------------------\n");
+}
+
+static void console_end(FILE*) {}
+
+//============================================================================================================
+
+static void json_begin(FILE* out) {
+    fprintf(out, "{\n  \"benchmarks\": [");
+}
+
+static void json_report(FILE* out, const benchmark_t* bm, size_t index) {
+    assert(out);
+    assert(bm);
+
+    const testing_results_t* results = &bm->testing_results;
+    const statistics_t* stats = &results->stats;
+
+    fprintf(out, "%s\n    {\n      \"name\": ", index ? "," : "");
+    json_string(out, bm->name);
+
+    fprintf(out, ",\n      \"args\": [");
+    for (size_t i = 0; i < bm->args_cnt; i++) {
+        fprintf(out, "%s%lld", i ? ", " : "", (long long) bm->args[i]);
+    }
+    fprintf(out, "]");
+
+    fprintf(out, ",\n      \"config\": {\"min_warmup_time_ns\": %llu, \"max_test_time_ns\": %llu, "
+                 "\"sample_time_ns\": %llu, \"epsilon\": ",
+                 (unsigned long long) bm->min_warmup_time, (unsigned long long) bm->max_test_time,
+                 (unsigned long long) bm->sample_time);
+    json_number(out, bm->epsilon);
+    fprintf(out, ", \"timer\": \"%s\", \"units\": \"%s\", \"ns_per_tick\": ",
+                 timer_backend_name(bm->timer), timer_backend_units(bm->timer));
+    json_number(out, bm->ns_per_tick);
+    fprintf(out, ", \"subtract_baseline\": %s, \"max_samples\": %zu}",
+                 bm->subtract_baseline ? "true" : "false", bm->max_samples);
+
+    fprintf(out, ",\n      \"warmup\": {\"time\": %llu, \"tests\": %zu",
+                 (unsigned long long) bm->warmup_results.time, bm->warmup_results.tests_cnt);
+    if (bm->warmup_results.steady_state) {
+        fprintf(out, ", \"steady_state\": {\"stabilized\": %s, \"tests\": %zu, \"iterations\": %zu}",
+                     bm->warmup_results.stabilized ? "true" : "false", bm->warmup_results.stable_tests,
+                     bm->warmup_results.stable_iterations);
+    }
+    fprintf(out, "}");
+
+    fprintf(out, ",\n      \"testing\": {\"time\": %llu, \"tests\": %zu, \"iterations\": %zu, \"average_time\": ",
+                 (unsigned long long) results->time, results->tests_cnt, results->iterations);
+    json_number(out, results->average_time);
+    fprintf(out, ", \"average_relative_deviation\": ");
+    json_number(out, results->average_relative_deviation);
+    fprintf(out, ", \"baseline\": ");
+    json_number(out, results->baseline);
+    fprintf(out, ", \"baseline_subtracted\": %s, \"timer_overhead\": ",
+                 results->baseline_subtracted ? "true" : "false");
+    json_number(out, results->timer_overhead);
+    fprintf(out, ", \"pause_overhead\": ");
+    json_number(out, results->pause_overhead);
+    fprintf(out, ", \"clamped_samples\": %zu, \"threads\": %zu, \"thread_time_min\": ",
+                 results->clamped_samples, results->threads);
+    json_number(out, results->thread_time_min);
+    fprintf(out, ", \"thread_time_max\": ");
+    json_number(out, results->thread_time_max);
+    fprintf(out, ", \"throughput\": ");
+    json_number(out, results->throughput);
+    fprintf(out, ", \"bytes_per_second\": ");
+    json_number(out, results->bytes_per_second);
+    fprintf(out, ", \"items_per_second\": ");
+    json_number(out, results->items_per_second);
+    fprintf(out, "}");
+
+    fprintf(out, ",\n      \"user_counters\": [");
+    for (size_t i = 0; i < results->user_counters_cnt; i++) {
+        fprintf(out, "%s{\"name\": ", i ? ", " : "");
+        json_string(out, results->user_counters[i].name);
+        fprintf(out, ", \"kind\": \"%s\", \"value\": ", user_counter_kind_name(results->user_counters[i].kind));
+        json_number(out, results->user_counters[i].value);
+        fprintf(out, "}");
+    }
+    fprintf(out, "]");
+
+    const char* const stat_names[] = {"min", "median", "p90", "p99", "p99.9", "max", "mean", "stddev", "mad",
+                                      "mean_ci_low", "mean_ci_high", "median_ci_low", "median_ci_high"};
+    const double stat_values[] = {stats->min, stats->median, stats->p90, stats->p99, stats->p999, stats->max,
+                                  stats->mean, stats->stddev, stats->mad,
+                                  stats->mean_ci_low, stats->mean_ci_high,
+                                  stats->median_ci_low, stats->median_ci_high};
+
+    fprintf(out, ",\n      \"statistics\": {\"samples\": %zu", stats->size);
+    for (size_t i = 0; i < sizeof(stat_values) / sizeof(stat_values[0]); i++) {
+        fprintf(out, ", \"%s\": ", stat_names[i]);
+        json_number(out, stat_values[i]);
+    }
+    fprintf(out, ", \"outliers_low\": %zu, \"outliers_high\": %zu, \"confidence_level\": ",
+                 stats->outliers_low, stats->outliers_high);
+    json_number(out, stats->confidence_level);
+    fprintf(out, "}");
+
+    fprintf(out, ",\n      \"histogram\": {\"samples\": %llu", (unsigned long long) bm->histogram.total);
+    for (size_t i = 0; i < REPORTED_PERCENTILES_CNT; i++) {
+        fprintf(out, ", \"%s\": ", REPORTED_PERCENTILE_NAMES[i]);
+        json_number(out, histogram_percentile(&bm->histogram, REPORTED_PERCENTILES[i]));
+    }
+    fprintf(out, "}");
+
+    if (results->counters.measured) {
+        json_counters(out, &results->counters);
+    }
+
+    if (results->allocations.measured) {
+        fprintf(out, ",\n      \"allocations\": {\"allocations\": ");
+        json_number(out, results->allocations.allocations);
+        fprintf(out, ", \"frees\": ");
+        json_number(out, results->allocations.frees);
+        fprintf(out, ", \"bytes\": ");
+        json_number(out, results->allocations.bytes);
+        fprintf(out, ", \"peak_live_bytes\": %lld}", (long long) results->allocations.peak_live_bytes);
+    }
+
+    if (results->precision.measured) {
+        const precision_results_t* precision = &results->precision;
+
+        fprintf(out, ",\n      \"precision\": {\"statistic\": \"%s\", \"confidence\": ",
+                     bm->precision.statistic == PRECISION_MEDIAN ? "median" : "mean");
+        json_number(out, bm->precision.confidence);
+        fprintf(out, ", \"target\": ");
+        json_number(out, bm->precision.target);
+        fprintf(out, ", \"estimate\": ");
+        json_number(out, precision->estimate);
+        fprintf(out, ", \"half_width\": ");
+        json_number(out, precision->half_width);
+        fprintf(out, ", \"relative\": ");
+        json_number(out, precision->relative);
+        fprintf(out, ", \"reached\": %s, \"samples\": %zu}", precision->reached ? "true" : "false",
+                     precision->samples);
+    }
+
+    if (results->repetitions.repetitions) {
+        const repetitions_results_t* repetitions = &results->repetitions;
+
+        fprintf(out, ",\n      \"repetitions\": {\"repetitions\": %zu, \"mean\": ", repetitions->repetitions);
+        json_number(out, repetitions->mean);
+        fprintf(out, ", \"median\": ");
+        json_number(out, repetitions->median);
+        fprintf(out, ", \"stddev\": ");
+        json_number(out, repetitions->stddev);
+        fprintf(out, ", \"min\": ");
+        json_number(out, repetitions->min);
+        fprintf(out, ", \"max\": ");
+        json_number(out, repetitions->max);
+        fprintf(out, ", \"average_times\": [");
+        for (size_t i = 0; i < repetitions->repetitions; i++) {
+            fprintf(out, i ? ", " : "");
+            json_number(out, bm->repetition_times[i]);
+        }
+        fprintf(out, "]}");
+    }
+
+    if (bm->environment.checked) {
+        json_environment(out, &bm->environment);
+    }
+
+    fprintf(out, "\n    }");
+}
+
+// Counters the PMU doesn't have are null.
+static void json_counters(FILE* out, const counters_results_t* counters) {
+    fprintf(out, ",\n      \"counters\": {");
+
+    for (size_t i = 0; i < PERF_COUNTERS_CNT; i++) {
+        fprintf(out, "%s\"%s\": ", i ? ", " : "", perf_counter_name((perf_counter_t) i));
+        json_number(out, counters->available[i] ? counters->per_iteration[i] : NAN);
+    }
+
+    const char* const derived_names[] = {"ipc", "l1d_mpki", "llc_mpki", "branch_mpki", "dtlb_mpki", "running_ratio"};
+    const double derived_values[] = {counters->ipc, counters->l1d_mpki, counters->llc_mpki,
+                                     counters->branch_mpki, counters->dtlb_mpki, counters->running_ratio};
+
+    for (size_t i = 0; i < sizeof(derived_values) / sizeof(derived_values[0]); i++) {
+        fprintf(out, ", \"%s\": ", derived_names[i]);
+        json_number(out, derived_values[i]);
+    }
+
+    fprintf(out, "}");
+}
+
+static void json_environment(FILE* out, const environment_t* env) {
+    fprintf(out, ",\n      \"environment\": {\"cpu\": %d, \"pinned\": %s, \"nice\": %d, \"priority_raised\": %s, "
+                 "\"governor\": ",
+                 env->cpu, env->pinned ? "true" : "false", env->nice, env->priority_raised ? "true" : "false");
+    json_string(out, env->governor);
+    fprintf(out, ", \"cur_freq_khz\": %ld, \"min_freq_khz\": %ld, \"max_freq_khz\": %ld, \"turbo\": %s, "
+                 "\"smt_siblings\": ",
+                 env->cur_freq, env->min_freq, env->max_freq,
+                 env->turbo < 0 ? "null" : env->turbo ? "true" : "false");
+    json_string(out, env->smt_siblings);
+
+    fprintf(out, ", \"warnings\": [");
+    size_t warnings_cnt = 0;
+    for (size_t i = 0; i < ENVIRONMENT_WARNINGS_CNT; i++) {
+        if (env->warnings & (1u << i)) {
+            fprintf(out, "%s", warnings_cnt++ ? ", " : "");
+            json_string(out, environment_warning_name((environment_warning_t) (1u << i)));
+        }
+    }
+    fprintf(out, "]}");
+}
+
+static void json_complexity(FILE* out, const benchmark_t* family, size_t index) {
+    assert(out);
+    assert(family);
+
+    const complexity_fit_t* fit = &family->complexity_fit;
+
+    fprintf(out, "%s\n    {\n      \"name\": ", index ? "," : "");
+    json_string(out, family->name);
+    fprintf(out, ",\n      \"complexity\": {\"fit\": \"%s\", \"points\": %zu, \"units\": \"%s\", \"coefficient\": ",
+                 complexity_name(fit->complexity), fit->points_cnt, timer_backend_units(family->timer));
+    json_number(out, fit->coefficient);
+    fprintf(out, ", \"rms\": ");
+    json_number(out, fit->rms);
+    fprintf(out, "}\n    }");
+}
+
+static void json_scaling(FILE* out, const benchmark_t* family, size_t index) {
+    assert(out);
+    assert(family);
+
+    fprintf(out, "%s\n    {\n      \"name\": ", index ? "," : "");
+    json_string(out, family->name);
+    fprintf(out, ",\n      \"scaling\": [");
+
+    size_t rows_cnt = 0;
+    for (const benchmark_t* instance = family->next; instance && instance->family == family;
+         instance = instance->next) {
+        const testing_results_t* results = &instance->testing_results;
+        if (!results->tests_cnt) {
+            continue;
+        }
+
+        fprintf(out, "%s\n        {\"name\": ", rows_cnt++ ? "," : "");
+        json_string(out, instance->name);
+        fprintf(out, ", \"threads\": %zu, \"throughput\": ", results->threads);
+        json_number(out, results->throughput);
+        fprintf(out, ", \"speedup\": ");
+        json_number(out, results->speedup);
+        fprintf(out, ", \"efficiency\": ");
+        json_number(out, results->efficiency);
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "\n      ]\n    }");
+}
+
+static void json_end(FILE* out) {
+    fprintf(out, "\n  ]\n}\n");
+}
+
+//============================================================================================================
+
+static void csv_begin(FILE* out) {
+    fprintf(out, "name,timer,units,min_warmup_time_ns,max_test_time_ns,sample_time_ns,epsilon,"
+                 "warmup_time,warmup_tests,warmup_stabilized,warmup_stable_iterations,time,tests,iterations,average_time,average_relative_deviation,"
+                 "baseline,baseline_subtracted,timer_overhead,samples,min,median,p90,p99,p99.9,max,"
+                 "mean,stddev,mad,outliers_low,outliers_high,mean_ci_low,mean_ci_high,"
+                 "median_ci_low,median_ci_high,threads,thread_time_min,thread_time_max,throughput,"
+                 "cycles,instructions,l1d_misses,llc_misses,branch_misses,dtlb_misses,ipc,"
+                 "allocations,frees,bytes_allocated,peak_live_bytes,bytes_per_second,items_per_second,user_counters,"
+                 "repetitions,repetitions_mean,repetitions_median,repetitions_stddev,"
+                 "precision_target,precision_relative,precision_reached,"
+                 "cpu,pinned,governor,cur_freq_khz,turbo,environment_warnings\n");
+}
+
+static void csv_report(FILE* out, const benchmark_t* bm, size_t) {
+    assert(out);
+    assert(bm);
+
+    const testing_results_t* results = &bm->testing_results;
+    const statistics_t* stats = &results->stats;
+
+    csv_string(out, bm->name);
+    fprintf(out, ",%s,%s,%llu,%llu,%llu,%g,%llu,%zu,",
+                 timer_backend_name(bm->timer), timer_backend_units(bm->timer),
+                 (unsigned long long) bm->min_warmup_time, (unsigned long long) bm->max_test_time,
+                 (unsigned long long) bm->sample_time, bm->epsilon,
+                 (unsigned long long) bm->warmup_results.time, bm->warmup_results.tests_cnt);
+
+    if (bm->warmup_results.steady_state) {
+        fprintf(out, "%d,%zu,", bm->warmup_results.stabilized, bm->warmup_results.stable_iterations);
+    }
+    else {
+        fprintf(out, ",,");
+    }
+
+    fprintf(out, "%llu,%zu,%zu,%.10g,%.10g,%.10g,%d,%.10g,%zu,",
+                 (unsigned long long) results->time, results->tests_cnt, results->iterations,
+                 results->average_time, results->average_relative_deviation,
+                 results->baseline, results->baseline_subtracted, results->timer_overhead,
+                 stats->size);
+    fprintf(out, "%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%zu,%zu,%.10g,%.10g,%.10g,%.10g,",
+                 stats->min, stats->median, stats->p90, stats->p99, stats->p999, stats->max,
+                 stats->mean, stats->stddev, stats->mad, stats->outliers_low, stats->outliers_high,
+                 stats->mean_ci_low, stats->mean_ci_high, stats->median_ci_low, stats->median_ci_high);
+    fprintf(out, "%zu,%.10g,%.10g,%.10g,", results->threads, results->thread_time_min, results->thread_time_max,
+                 results->throughput);
+
+    csv_counters(out, &results->counters);
+
+    if (results->allocations.measured) {
+        fprintf(out, "%.10g,%.10g,%.10g,%lld,", results->allocations.allocations, results->allocations.frees,
+                     results->allocations.bytes, (long long) results->allocations.peak_live_bytes);
+    }
+    else {
+        fprintf(out, ",,,,");
+    }
+
+    fprintf(out, "%.10g,%.10g,", results->bytes_per_second, results->items_per_second);
+
+    char counters[FILENAME_MAX] = {};
+    size_t len = 0;
+    for (size_t i = 0; i < results->user_counters_cnt && len < sizeof(counters); i++) {
+        len += (size_t) snprintf(counters + len, sizeof(counters) - len, "%s%s=%.10g", len ? ";" : "",
+                                 results->user_counters[i].name, results->user_counters[i].value);
+    }
+    csv_string(out, counters);
+    fprintf(out, ",");
+
+    const repetitions_results_t* repetitions = &results->repetitions;
+    if (repetitions->repetitions) {
+        fprintf(out, "%zu,%.10g,%.10g,%.10g,", repetitions->repetitions, repetitions->mean, repetitions->median,
+                     repetitions->stddev);
+    }
+    else {
+        fprintf(out, ",,,,");
+    }
+
+    if (results->precision.measured) {
+        fprintf(out, "%.10g,%.10g,%d,", bm->precision.target, results->precision.relative, results->precision.reached);
+    }
+    else {
+        fprintf(out, ",,,");
+    }
+
+    csv_environment(out, &bm->environment);
+    fprintf(out, "\n");
+}
+
+// CSV rows have a fixed set of columns; complexity fits are left to the console and JSON reports.
+static void csv_complexity(FILE*, const benchmark_t*, size_t) {}
+
+// Speedup and efficiency follow from the throughput column of the instances.
+static void csv_scaling(FILE*, const benchmark_t*, size_t) {}
+
+static void csv_end(FILE*) {}
+
+// Columns of unavailable counters stay empty.
+static void csv_counters(FILE* out, const counters_results_t* counters) {
+    for (size_t i = 0; i < PERF_COUNTERS_CNT; i++) {
+        if (counters->measured && counters->available[i]) {
+            fprintf(out, "%.10g", counters->per_iteration[i]);
+        }
+        fprintf(out, ",");
+    }
+
+    if (counters->measured && counters->available[COUNTER_CYCLES] && counters->available[COUNTER_INSTRUCTIONS]) {
+        fprintf(out, "%.10g", counters->ipc);
+    }
+    fprintf(out, ",");
+}
+
+// Columns stay empty when the environment stage didn't run; warnings are joined with ';'.
+static void csv_environment(FILE* out, const environment_t* env) {
+    if (!env->checked) {
+        fprintf(out, ",,,,,");
+        return;
+    }
+
+    fprintf(out, "%d,%d,", env->cpu, env->pinned);
+    csv_string(out, env->governor);
+    fprintf(out, ",%ld,%d,", env->cur_freq, env->turbo);
+
+    char warnings[FILENAME_MAX] = {};
+    size_t len = 0;
+    for (size_t i = 0; i < ENVIRONMENT_WARNINGS_CNT && len < sizeof(warnings); i++) {
+        if (env->warnings & (1u << i)) {
+            len += (size_t) snprintf(warnings + len, sizeof(warnings) - len, "%s%s", len ? ";" : "",
+                                     environment_warning_name((environment_warning_t) (1u << i)));
+        }
+    }
+    csv_string(out, warnings);
+}
+
+//============================================================================================================
+
+// Largest prefix that leaves at least 1 in front of the point.
+static double scale_value(double value, double base, const char** prefix) {
+    const char* const* prefixes = base == BINARY_BASE ? BINARY_PREFIXES : DECIMAL_PREFIXES;
+    size_t power = 0;
+
+    while (fabs(value) >= base && power + 1 < PREFIXES_CNT) {
+        value /= base;
+        power++;
+    }
+
+    *prefix = prefixes[power];
+    return value;
+}
+
+static const char* user_counter_kind_name(user_counter_kind_t kind) {
+    switch (kind) {
+        case USER_COUNTER_AVERAGE:
+            return "average";
+        case USER_COUNTER_SUM:
+            return "sum";
+        case USER_COUNTER_RATE:
+            return "rate";
+        default:
+            assert(0 && "Undefined user counter kind");
+            return "unknown";
+    }
+}
+
+static void json_string(FILE* out, const char* str) {
+    assert(str);
+
+    fputc('"', out);
+
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            fprintf(out, "\\%c", *str);
+        }
+        else if ((unsigned char) *str < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char) *str);
+        }
+        else {
+            fputc(*str, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+static void json_number(FILE* out, double value) {
+    if (isfinite(value)) {
+        fprintf(out, "%.10g", value);
+    }
+    else {
+        fprintf(out, "null");
+    }
+}
+
+static void csv_string(FILE* out, const char* str) {
+    assert(str);
+
+    if (!strpbrk(str, ",\"\n")) {
+        fputs(str, out);
+        return;
+    }
+
+    fputc('"', out);
+    for (; *str; str++) {
+        if (*str == '"') {
+            fputc('"', out);
+        }
+        fputc(*str, out);
+    }
+    fputc('"', out);
+}
@@ -0,0 +1,40 @@
+#ifndef REPORTER_H
+#define REPORTER_H
+
+#include <stdio.h>
+
+#include "benchmark.h"
+
+typedef enum {
+    REPORT_CONSOLE = 0,
+    REPORT_JSON    = 1,
+    REPORT_CSV     = 2,
+} report_format_t;
+
+typedef struct {
+    void (*begin) (FILE* out);
+    void (*report) (FILE* out, const benchmark_t* bm, size_t index);
+    void (*complexity) (FILE* out, const benchmark_t* family, size_t index);
+    void (*scaling) (FILE* out, const benchmark_t* family, size_t index);
+    void (*end) (FILE* out);
+} reporter_t;
+
+typedef struct {
+    report_format_t format;
+    FILE* out;
+    size_t reported_cnt;
+} report_config_t;
+
+void set_reporter(report_format_t format);
+bool set_report_format(const char* name);
+bool set_report_file(const char* path);
+
+FILE* report_text_stream();
+
+void report_begin();
+void report_benchmark(const benchmark_t* bm);
+void report_complexity(const benchmark_t* family);
+void report_scaling(const benchmark_t* family);
+void report_end();
+
+#endif /* REPORTER_H */
@@ -0,0 +1,538 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <math.h>
+
+#include "stats.h"
+#include "logger.h"
+
+static int compare_doubles_asc(const void* a, const void* b);
+static double median_of(double* data, size_t size);
+static uint64_t next_random(uint64_t* state);
+static void bootstrap(const double* samples, size_t size, statistics_t* stats);
+static double average_rank(const double* sorted, size_t size, double value);
+static double incomplete_beta(double a, double b, double x);
+static double incomplete_beta_fraction(double a, double b, double x);
+static double student_t_upper_tail(double t, double df);
+
+//============================================================================================================
+
+const size_t BOOTSTRAP_RESAMPLES = 1000;
+const size_t BOOTSTRAP_MAX_RESAMPLE_SIZE = 10000;
+const uint64_t BOOTSTRAP_SEED = 0x9e3779b97f4a7c15;
+const double CONFIDENCE_LEVEL = 0.95;
+const double IQR_OUTLIER_FACTOR = 1.5;
+const double MAD_NORMAL_SCALE = 1.4826;
+const size_t BETA_FRACTION_ITERATIONS = 300;
+const double BETA_FRACTION_EPSILON = 1e-14;
+const double BETA_FRACTION_TINY = 1e-300;
+const size_t QUANTILE_BISECTIONS = 64;
+const double NORMAL_DF = 1e6;   // Student's t is the normal distribution from here on
+
+//============================================================================================================
+
+bool samples_ctor(samples_t* samples, size_t capacity, arena_t* arena) {
+    assert(samples);
+    assert(capacity != 0);
+
+    *samples = samples_t(arena);
+    return samples->reserve(capacity);
+}
+
+void samples_dtor(samples_t* samples) {
+    assert(samples);
+
+    *samples = samples_t();
+}
+
+void samples_clear(samples_t* samples) {
+    assert(samples);
+
+    samples->clear();
+}
+
+//============================================================================================================
+
+void compute_statistics(const double* samples, size_t size, statistics_t* stats, bool intervals) {
+    assert(stats);
+
+    memset(stats, 0, sizeof(statistics_t));
+    if (!samples || !size) {
+        return;
+    }
+
+    double* sorted = (double*) calloc(size, sizeof(double));
+    if (!sorted) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return;
+    }
+
+    memcpy(sorted, samples, size * sizeof(double));
+    qsort(sorted, size, sizeof(double), compare_doubles_asc);
+
+    stats->size   = size;
+    stats->min    = sorted[0];
+    stats->median = percentile(sorted, size, 0.5);
+    stats->p90    = percentile(sorted, size, 0.9);
+    stats->p99    = percentile(sorted, size, 0.99);
+    stats->p999   = percentile(sorted, size, 0.999);
+    stats->max    = sorted[size - 1];
+
+    double sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += sorted[i];
+    }
+    stats->mean = sum / (double) size;
+
+    double squares = 0;
+    for (size_t i = 0; i < size; i++) {
+        squares += (sorted[i] - stats->mean) * (sorted[i] - stats->mean);
+    }
+    stats->stddev = size > 1 ? sqrt(squares / (double) (size - 1)) : 0;
+
+    double q1 = percentile(sorted, size, 0.25);
+    double q3 = percentile(sorted, size, 0.75);
+    double low_fence  = q1 - IQR_OUTLIER_FACTOR * (q3 - q1);
+    double high_fence = q3 + IQR_OUTLIER_FACTOR * (q3 - q1);
+
+    for (size_t i = 0; i < size; i++) {
+        stats->outliers_low  += sorted[i] < low_fence;
+        stats->outliers_high += sorted[i] > high_fence;
+    }
+
+    // sorted is reused as scratch for absolute deviations from here on
+    for (size_t i = 0; i < size; i++) {
+        sorted[i] = fabs(sorted[i] - stats->median);
+    }
+    stats->mad = MAD_NORMAL_SCALE * median_of(sorted, size);
+
+    free(sorted);
+
+    if (intervals) {
+        bootstrap(samples, size, stats);
+    }
+}
+
+// Linear interpolation between the two closest ranks.
+double percentile(const double* sorted, size_t size, double p) {
+    assert(sorted);
+    assert(size != 0);
+
+    double rank = p * (double) (size - 1);
+    size_t low = (size_t) rank;
+
+    if (low + 1 >= size) {
+        return sorted[size - 1];
+    }
+
+    return sorted[low] + (rank - (double) low) * (sorted[low + 1] - sorted[low]);
+}
+
+// Quickselect: moves the k-th smallest element to data[k] and returns it.
+double select_kth(double* data, size_t size, size_t k) {
+    assert(data);
+    assert(k < size);
+
+    ptrdiff_t left = 0;
+    ptrdiff_t right = (ptrdiff_t) size - 1;
+    ptrdiff_t target = (ptrdiff_t) k;
+
+    while (left < right) {
+        double pivot = data[left + (right - left) / 2];
+        ptrdiff_t i = left;
+        ptrdiff_t j = right;
+
+        while (i <= j) {
+            while (data[i] < pivot) i++;
+            while (data[j] > pivot) j--;
+
+            if (i <= j) {
+                double tmp = data[i];
+                data[i++] = data[j];
+                data[j--] = tmp;
+            }
+        }
+
+        if (target <= j) {
+            right = j;
+        }
+        else if (target >= i) {
+            left = i;
+        }
+        else {
+            break;
+        }
+    }
+
+    return data[k];
+}
+
+//============================================================================================================
+
+// Acklam's rational approximation, relative error below 1.2e-9.
+double normal_quantile(double p) {
+    static const double a[] = {-3.969683028665376e+01,  2.209460984245205e+02, -2.759285104469687e+02,
+                                1.383577518672690e+02, -3.066479806614716e+01,  2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01,  1.615858368580409e+02, -1.556989798598866e+02,
+                                6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00,  4.374664141464968e+00,  2.938163982698783e+00};
+    static const double d[] = { 7.784695709041462e-03,  3.224671290700398e-01,  2.445134137142996e+00,
+                                3.754408661907416e+00};
+    const double low = 0.02425;
+
+    if (p <= 0) {
+        return -INFINITY;
+    }
+    if (p >= 1) {
+        return INFINITY;
+    }
+
+    if (p < low || p > 1 - low) {
+        double q = sqrt(-2 * log(p < low ? p : 1 - p));
+        double x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                   ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        return p < low ? x : -x;
+    }
+
+    double q = p - 0.5;
+    double r = q * q;
+
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+// Bisection on the upper tail, which is monotonic in t, between 0 and a bound doubled until it brackets p.
+double student_t_quantile(double p, double df) {
+    if (df >= NORMAL_DF) {
+        return normal_quantile(p);
+    }
+    if (p <= 0) {
+        return -INFINITY;
+    }
+    if (p >= 1) {
+        return INFINITY;
+    }
+    if (p < 0.5) {
+        return -student_t_quantile(1 - p, df);
+    }
+
+    double tail = 1 - p;
+    double low = 0;
+    double high = 1;
+
+    while (student_t_upper_tail(high, df) > tail) {
+        low = high;
+        high *= 2;
+    }
+
+    for (size_t i = 0; i < QUANTILE_BISECTIONS; i++) {
+        double middle = (low + high) / 2;
+
+        if (student_t_upper_tail(middle, df) > tail) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return (low + high) / 2;
+}
+
+void median_confidence_interval(double* data, size_t size, double confidence, double* low, double* high) {
+    assert(data);
+    assert(size != 0);
+    assert(low);
+    assert(high);
+
+    double z = normal_quantile((1 + confidence) / 2);
+    double spread = z * sqrt((double) size) / 2;
+    double middle = (double) size / 2;
+
+    // 1-based ranks floor(n/2 - spread) and ceil(1 + n/2 + spread), clamped to the sample.
+    double low_rank = floor(middle - spread);
+    double high_rank = ceil(1 + middle + spread);
+
+    size_t low_index = low_rank > 1 ? (size_t) low_rank - 1 : 0;
+    size_t high_index = high_rank < (double) size ? (size_t) high_rank - 1 : size - 1;
+
+    // Selecting the upper bound leaves the smaller elements in front of it.
+    *high = select_kth(data, size, high_index);
+    *low = low_index < high_index ? select_kth(data, high_index, low_index) : *high;
+}
+
+double segment_drift(double* data, size_t size, size_t segments) {
+    assert(data);
+    assert(segments != 0);
+    assert(size >= segments);
+
+    double low = INFINITY;
+    double high = -INFINITY;
+
+    for (size_t i = 0; i < segments; i++) {
+        size_t begin = i * size / segments;
+        size_t end = (i + 1) * size / segments;
+        double median = median_of(data + begin, end - begin);
+
+        low = fmin(low, median);
+        high = fmax(high, median);
+    }
+
+    if (high <= low) {
+        return 0;
+    }
+
+    return low > 0 ? (high - low) / low : INFINITY;
+}
+
+//============================================================================================================
+
+// Two-sided p-value of Welch's unequal-variance t-test, with Welch-Satterthwaite degrees of freedom.
+double welch_t_test(double mean_a, double stddev_a, size_t size_a,
+                    double mean_b, double stddev_b, size_t size_b) {
+    if (size_a < 2 || size_b < 2) {
+        return 1;
+    }
+
+    double var_a = stddev_a * stddev_a / (double) size_a;
+    double var_b = stddev_b * stddev_b / (double) size_b;
+
+    if (var_a + var_b == 0) {
+        return mean_a == mean_b ? 1 : 0;
+    }
+
+    double t = (mean_a - mean_b) / sqrt(var_a + var_b);
+    double df = (var_a + var_b) * (var_a + var_b) /
+                (var_a * var_a / (double) (size_a - 1) + var_b * var_b / (double) (size_b - 1));
+
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
+
+// Two-sided p-value of the Mann-Whitney U test: normal approximation with tie and continuity
+// corrections, adequate for the sample counts a benchmark produces.
+double mann_whitney_u_test(const double* a, size_t size_a, const double* b, size_t size_b) {
+    assert(a);
+    assert(b);
+
+    if (!size_a || !size_b) {
+        return 1;
+    }
+
+    size_t size = size_a + size_b;
+
+    double* sorted = (double*) calloc(size, sizeof(double));
+    if (!sorted) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        return 1;
+    }
+
+    memcpy(sorted, a, size_a * sizeof(double));
+    memcpy(sorted + size_a, b, size_b * sizeof(double));
+    qsort(sorted, size, sizeof(double), compare_doubles_asc);
+
+    double ties = 0;
+    for (size_t i = 0; i < size;) {
+        size_t j = i;
+        while (j < size && sorted[j] == sorted[i]) {
+            j++;
+        }
+
+        double tied = (double) (j - i);
+        ties += tied * tied * tied - tied;
+        i = j;
+    }
+
+    double rank_sum_a = 0;
+    for (size_t i = 0; i < size_a; i++) {
+        rank_sum_a += average_rank(sorted, size, a[i]);
+    }
+
+    free(sorted);
+
+    double n_a = (double) size_a;
+    double n_b = (double) size_b;
+    double n = (double) size;
+
+    double u = rank_sum_a - n_a * (n_a + 1) / 2;
+    double sigma = sqrt(n_a * n_b / 12 * ((n + 1) - ties / (n * (n - 1))));
+
+    if (sigma == 0) {
+        return 1;
+    }
+
+    double z = (fabs(u - n_a * n_b / 2) - 0.5) / sigma;
+    return z > 0 ? erfc(z / sqrt(2)) : 1;
+}
+
+//============================================================================================================
+
+static double median_of(double* data, size_t size) {
+    double upper = select_kth(data, size, size / 2);
+    if (size % 2) {
+        return upper;
+    }
+
+    return (select_kth(data, size / 2, size / 2 - 1) + upper) / 2;
+}
+
+// xorshift64*: fixed seed keeps the intervals reproducible between runs over the same samples.
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1d;
+}
+
+// Percentile bootstrap: resamples with replacement and takes the central confidence_level
+// quantiles of the resampled means and medians. Past BOOTSTRAP_MAX_RESAMPLE_SIZE samples the resamples
+// are drawn smaller (m out of n bootstrap) and the intervals shrunk around the sample statistics by
+// sqrt(m / n), as both statistics converge at the square root rate.
+static void bootstrap(const double* samples, size_t size, statistics_t* stats) {
+    stats->confidence_level = CONFIDENCE_LEVEL;
+
+    size_t resample_size = size < BOOTSTRAP_MAX_RESAMPLE_SIZE ? size : BOOTSTRAP_MAX_RESAMPLE_SIZE;
+
+    double* means   = (double*) calloc(BOOTSTRAP_RESAMPLES, sizeof(double));
+    double* medians = (double*) calloc(BOOTSTRAP_RESAMPLES, sizeof(double));
+    double* resample = (double*) calloc(resample_size, sizeof(double));
+
+    if (!means || !medians || !resample) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        free(means);
+        free(medians);
+        free(resample);
+        return;
+    }
+
+    uint64_t state = BOOTSTRAP_SEED;
+
+    for (size_t r = 0; r < BOOTSTRAP_RESAMPLES; r++) {
+        double sum = 0;
+
+        for (size_t i = 0; i < resample_size; i++) {
+            resample[i] = samples[next_random(&state) % size];
+            sum += resample[i];
+        }
+
+        means[r] = sum / (double) resample_size;
+        medians[r] = median_of(resample, resample_size);
+    }
+
+    qsort(means, BOOTSTRAP_RESAMPLES, sizeof(double), compare_doubles_asc);
+    qsort(medians, BOOTSTRAP_RESAMPLES, sizeof(double), compare_doubles_asc);
+
+    double tail = (1 - CONFIDENCE_LEVEL) / 2;
+    double scale = sqrt((double) resample_size / (double) size);
+
+    stats->mean_ci_low    = stats->mean + scale * (percentile(means, BOOTSTRAP_RESAMPLES, tail) - stats->mean);
+    stats->mean_ci_high   = stats->mean + scale * (percentile(means, BOOTSTRAP_RESAMPLES, 1 - tail) - stats->mean);
+    stats->median_ci_low  = stats->median + scale * (percentile(medians, BOOTSTRAP_RESAMPLES, tail) - stats->median);
+    stats->median_ci_high = stats->median + scale * (percentile(medians, BOOTSTRAP_RESAMPLES, 1 - tail) - stats->median);
+
+    free(means);
+    free(medians);
+    free(resample);
+}
+
+// 1-based rank of value in sorted, averaged over the run of equal elements.
+static double average_rank(const double* sorted, size_t size, double value) {
+    size_t first = 0;
+    size_t last = size;
+
+    for (size_t upper = size; first < upper;) {
+        size_t middle = first + (upper - first) / 2;
+        if (sorted[middle] < value) {
+            first = middle + 1;
+        }
+        else {
+            upper = middle;
+        }
+    }
+
+    for (size_t lower = first; lower < last;) {
+        size_t middle = lower + (last - lower) / 2;
+        if (sorted[middle] <= value) {
+            lower = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+
+    return (double) (first + 1 + last) / 2;
+}
+
+// Regularized incomplete beta function I_x(a, b), evaluated by the continued fraction on
+// whichever side of the distribution converges quickly.
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0) {
+        return 0;
+    }
+    if (x >= 1) {
+        return 1;
+    }
+
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+
+    if (x < (a + 1) / (a + b + 2)) {
+        return front * incomplete_beta_fraction(a, b, x) / a;
+    }
+
+    return 1 - front * incomplete_beta_fraction(b, a, 1 - x) / b;
+}
+
+// Modified Lentz evaluation of the continued fraction for the incomplete beta function.
+static double incomplete_beta_fraction(double a, double b, double x) {
+    double c = 1;
+    double d = 1 - (a + b) * x / (a + 1);
+    if (fabs(d) < BETA_FRACTION_TINY) {
+        d = BETA_FRACTION_TINY;
+    }
+    d = 1 / d;
+
+    double result = d;
+
+    for (size_t i = 1; i <= BETA_FRACTION_ITERATIONS; i++) {
+        double m = (double) i;
+
+        for (size_t step = 0; step < 2; step++) {
+            double numerator = step == 0 ?   m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                         : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+
+            d = 1 + numerator * d;
+            if (fabs(d) < BETA_FRACTION_TINY) {
+                d = BETA_FRACTION_TINY;
+            }
+
+            c = 1 + numerator / c;
+            if (fabs(c) < BETA_FRACTION_TINY) {
+                c = BETA_FRACTION_TINY;
+            }
+
+            d = 1 / d;
+            result *= d * c;
+
+            if (step == 1 && fabs(d * c - 1) < BETA_FRACTION_EPSILON) {
+                return result;
+            }
+        }
+    }
+
+    return result;
+}
+
+// P(T > t) for t >= 0.
+static double student_t_upper_tail(double t, double df) {
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t)) / 2;
+}
+
+static int compare_doubles_asc(const void* a, const void* b) {
+    double lhs = *(const double*) a;
+    double rhs = *(const double*) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
@@ -0,0 +1,79 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "typed_vector.h"
+
+// Reserved once with samples_ctor(); samples past the capacity are dropped instead of growing the buffer
+// in the middle of a measurement.
+typedef vector<double> samples_t;
+
+typedef struct {
+    size_t size;
+
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+
+    double mean;
+    double stddev;
+    double mad;
+
+    size_t outliers_low;
+    size_t outliers_high;
+
+    double confidence_level;
+    double mean_ci_low;
+    double mean_ci_high;
+    double median_ci_low;
+    double median_ci_high;
+} statistics_t;
+
+//============================================================================================================
+
+bool samples_ctor(samples_t* samples, size_t capacity, arena_t* arena = nullptr);
+void samples_dtor(samples_t* samples);
+void samples_clear(samples_t* samples);
+
+inline bool samples_push(samples_t* samples, double sample) {
+    if (samples->size == samples->capacity) {
+        return false;
+    }
+
+    return samples->push_back(sample);
+}
+
+inline bool samples_full(const samples_t* samples) {
+    return samples->size == samples->capacity;
+}
+
+//============================================================================================================
+
+// Without intervals the bootstrap, the costly part, is skipped and the confidence intervals are left at zero.
+void compute_statistics(const double* samples, size_t size, statistics_t* stats, bool intervals = true);
+
+double percentile(const double* sorted, size_t size, double p);
+double select_kth(double* data, size_t size, size_t k);
+
+// Quantile functions of the standard normal and of Student's t distribution with df degrees of freedom.
+double normal_quantile(double p);
+double student_t_quantile(double p, double df);
+
+// Distribution-free interval for the median from the order statistics whose ranks bound it with the given
+// confidence under the binomial distribution (normal approximation). Reorders data.
+void median_confidence_interval(double* data, size_t size, double confidence, double* low, double* high);
+
+// Trend and changepoint measure of a series: the spread of the medians of its consecutive segments relative
+// to the smallest of them. A drift or a step anywhere in the series moves the medians apart, single spikes
+// don't. Reorders data within the segments.
+double segment_drift(double* data, size_t size, size_t segments);
+
+double welch_t_test(double mean_a, double stddev_a, size_t size_a,
+                    double mean_b, double stddev_b, size_t size_b);
+double mann_whitney_u_test(const double* a, size_t size_a, const double* b, size_t size_b);
+
+#endif /* STATS_H */
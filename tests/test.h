@@ -0,0 +1,36 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+// Minimal checks for the ctest suite. Unlike assert() they stay on in release builds and keep going
+// after a failure, so that one run reports every broken check.
+
+inline int* test_failures() {
+    static int failures = 0;
+    return &failures;
+}
+
+// Exit status of the test executable.
+inline int test_report() {
+    if (*test_failures()) {
+        fprintf(stderr, "%d checks failed\n", *test_failures());
+        return 1;
+    }
+
+    return 0;
+}
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            (*test_failures())++;                                                         \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    CHECK(fabs((double) (actual) - (double) (expected)) <= (double) (tolerance))
+
+#endif /* TEST_H */
@@ -0,0 +1,61 @@
+#include <stdint.h>
+
+#include "arena.h"
+#include "queue.h"
+#include "test.h"
+
+static void test_alloc() {
+    arena_t arena = {};
+    CHECK(arena_ctor(&arena, 10000, false));
+    CHECK(arena.size >= 10000);
+
+    char* first = (char*) arena_alloc(&arena, 3, 1);
+    char* second = (char*) arena_alloc(&arena, 8, 64);
+
+    CHECK(first == arena.base);
+    CHECK(((uintptr_t) second & 63) == 0);
+    CHECK(second >= first + 3);
+    CHECK(arena_alloc(&arena, arena.size, 1) == nullptr);
+
+    arena_reset(&arena);
+    CHECK(arena_alloc(&arena, 3, 1) == first);
+
+    arena_prefault(&arena);
+    arena_dtor(&arena);
+    CHECK(arena.base == nullptr);
+    CHECK(arena_alloc(&arena, 1, 1) == nullptr);
+}
+
+static void test_huge_pages() {
+    arena_t arena = {};
+    CHECK(arena_ctor(&arena, 1, true));
+    CHECK(arena.size == 2 << 20);
+    CHECK(((uintptr_t) arena.base & ((2 << 20) - 1)) == 0);
+
+    arena_dtor(&arena);
+}
+
+static void test_ring_in_arena() {
+    arena_t arena = {};
+    CHECK(arena_ctor(&arena, 4096, false));
+
+    spsc_ring_t ring = {};
+    CHECK(spsc_ring_ctor(&ring, 16, sizeof(double), &arena) == NO_ERRORS);
+    CHECK(ring.data == arena.base);
+
+    double value = 1.5;
+    CHECK(spsc_ring_push(&ring, &value));
+    value = 0;
+    CHECK(spsc_ring_pop(&ring, &value) && value == 1.5);
+
+    spsc_ring_dtor(&ring);
+    arena_dtor(&arena);
+}
+
+int main() {
+    test_alloc();
+    test_huge_pages();
+    test_ring_in_arena();
+
+    return test_report();
+}
@@ -0,0 +1,129 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "flight_recorder.h"
+#include "logger.h"
+#include "test.h"
+
+const size_t THREADS_CNT = 4;
+const size_t RECORDS_PER_THREAD = 1000;
+const size_t RECORDER_SIZE = 64 * 1024;
+
+static char path[] = "/tmp/test_flight_recorderXXXXXX";
+
+static size_t dump_lines(size_t cnt, const char* needle, char* last_line = nullptr) {
+    FILE* out = tmpfile();
+    CHECK(flight_recorder_dump(path, cnt, out));
+
+    char line[LOG_RECORD_SIZE] = "";
+    size_t lines = 0;
+
+    rewind(out);
+    while (fgets(line, sizeof(line), out)) {
+        if (strstr(line, needle)) {
+            lines++;
+            if (last_line) {
+                strcpy(last_line, line);
+            }
+        }
+    }
+
+    fclose(out);
+    return lines;
+}
+
+// Once the ring wraps, only the newest records are left, in order and whole.
+static void test_wrap_around() {
+    flight_recorder_t recorder = {};
+    CHECK(flight_recorder_ctor(&recorder, path, RECORDER_SIZE));
+
+    char record[128] = "";
+    for (size_t i = 0; i < 10000; i++) {
+        int len = snprintf(record, sizeof(record), "record %05zu %s\n", i, i % 2 ? "odd" : "even, a bit longer");
+        flight_recorder_write(&recorder, record, (size_t) len);
+    }
+
+    char last[LOG_RECORD_SIZE] = "";
+    size_t kept = dump_lines(0, "record ", last);
+    CHECK(kept > 1000);
+    CHECK(kept < 10000);
+    CHECK(!strcmp(last, "record 09999 odd\n"));
+
+    CHECK(dump_lines(10, "record ") == 10);
+    CHECK(dump_lines(10, "record 0999") == 10);
+
+    flight_recorder_dtor(&recorder);
+}
+
+static void* write_records(void* arg) {
+    flight_recorder_t* recorder = (flight_recorder_t*) arg;
+    char record[64] = "";
+
+    for (size_t i = 0; i < RECORDS_PER_THREAD; i++) {
+        int len = snprintf(record, sizeof(record), "thread record %zu\n", i);
+        flight_recorder_write(recorder, record, (size_t) len);
+    }
+
+    return nullptr;
+}
+
+static void test_concurrent_writes() {
+    flight_recorder_t recorder = {};
+    CHECK(flight_recorder_ctor(&recorder, path, 4 * RECORDER_SIZE));
+
+    pthread_t threads[THREADS_CNT] = {};
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_create(&threads[i], nullptr, write_records, &recorder);
+    }
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+
+    CHECK(dump_lines(0, "thread record") == THREADS_CNT * RECORDS_PER_THREAD);
+    CHECK(dump_lines(0, "thread record 999\n") == THREADS_CNT);
+
+    flight_recorder_dtor(&recorder);
+}
+
+// The records logged by a process that aborts can be read back from the file.
+static void test_crash() {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        LoggerSetFile(nullptr);
+        LoggerSetFlightRecorder(path, RECORDER_SIZE);
+
+        for (int i = 0; i < 100; i++) {
+            LOG(INFO, "before the crash %d\n", i);
+        }
+        abort();
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status));
+
+    char last[LOG_RECORD_SIZE] = "";
+    CHECK(dump_lines(0, "before the crash", last) == 100);
+    CHECK(strstr(last, "before the crash 99") != nullptr);
+    CHECK(dump_lines(0, "[INFO]") == 100);
+}
+
+int main() {
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    test_wrap_around();
+    test_concurrent_writes();
+    test_crash();
+
+    CHECK(!flight_recorder_dump("/nonexistent/flight", 0, stdout));
+
+    unlink(path);
+    return test_report();
+}
@@ -0,0 +1,274 @@
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "benchmark.h"
+#include "reporter.h"
+#include "regression.h"
+#include "test.h"
+
+// Runs two tiny benchmarks end to end and checks that the results hang together.
+
+static void spin(context_t* ctx) {
+    static volatile int sink = 0;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        sink = sink + 1;
+    }
+    ctx->items_processed = (int64_t) ctx->iterations;
+}
+
+const size_t WARMING_CALLS = 300;
+const long PAUSED_SLEEP_NS = 100000;
+const size_t PAUSED_WORK = 100;
+const size_t RELAPSE_START = 150;
+const size_t RELAPSE_CALLS = 300;
+
+// The timed work between the pauses is well above the pause overhead, so no sample is clamped to 0.
+static void paused(context_t* ctx) {
+    static volatile int sink = 0;
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        pause_timing(ctx);
+        sink = sink + 1;
+        resume_timing(ctx);
+
+        for (size_t j = 0; j < PAUSED_WORK; j++) {
+            sink = sink + 1;
+        }
+    }
+}
+
+// Sleeps while paused, so the pauses of several threads overlap even on one CPU.
+static void sleeping(context_t* ctx) {
+    static volatile int sink = 0;
+    const struct timespec pause = {0, PAUSED_SLEEP_NS};
+
+    for (size_t i = 0; i < ctx->iterations; i++) {
+        pause_timing(ctx);
+        nanosleep(&pause, nullptr);
+        resume_timing(ctx);
+        sink = sink + 1;
+    }
+}
+
+// Starts twice as slow and speeds up steadily over its first calls, as if caches or lazy initialization
+// had to warm up.
+static void warming(context_t* ctx) {
+    static volatile int sink = 0;
+    static size_t calls = 0;
+
+    size_t iterations = ctx->iterations;
+    if (calls < WARMING_CALLS) {
+        iterations += ctx->iterations * (WARMING_CALLS - calls) / WARMING_CALLS;
+    }
+    calls++;
+
+    for (size_t i = 0; i < iterations; i++) {
+        sink = sink + 1;
+    }
+}
+
+// Steady at first, then slows down steadily to twice the cost, and is steady again from then on.
+static void relapsing(context_t* ctx) {
+    static volatile int sink = 0;
+    static size_t calls = 0;
+
+    size_t iterations = ctx->iterations;
+    if (calls >= RELAPSE_START + RELAPSE_CALLS) {
+        iterations += ctx->iterations;
+    }
+    else if (calls >= RELAPSE_START) {
+        iterations += ctx->iterations * (calls - RELAPSE_START) / RELAPSE_CALLS;
+    }
+    calls++;
+
+    for (size_t i = 0; i < iterations; i++) {
+        sink = sink + 1;
+    }
+}
+
+static void check_results(const benchmark_t* bm) {
+    const testing_results_t* results = &bm->testing_results;
+
+    CHECK(results->tests_cnt > 0);
+    CHECK(results->iterations > 0);
+    CHECK(results->average_time > 0);
+    CHECK(results->stats.size == bm->samples.size);
+    CHECK(bm->samples.size > 0);
+    CHECK(bm->histogram.total >= bm->samples.size);
+    CHECK(results->stats.min <= results->stats.median && results->stats.median <= results->stats.max);
+    CHECK(results->throughput > 0);
+}
+
+// The stopping rule ends testing once the interval is narrow enough, or at the sample bound if it can't be.
+static void check_precision() {
+    benchmark_register("precise_mean", spin);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(5);
+    set_target_precision(0.05, 0.99);
+    run_benchmark();
+
+    const precision_results_t* precision = &benchmark()->testing_results.precision;
+    CHECK(precision->measured);
+    CHECK(precision->reached);
+    CHECK(precision->relative <= 0.05);
+    CHECK(precision->half_width > 0);
+
+    // The rule only sees the samples after the control group, the last ones of the buffer.
+    const samples_t* samples = &benchmark()->samples;
+    CHECK(precision->samples < samples->size);
+
+    double sum = 0;
+    for (size_t i = samples->size - precision->samples; i < samples->size; i++) {
+        sum += samples->data[i];
+    }
+    double mean = sum / (double) precision->samples;
+    CHECK_NEAR(precision->estimate, mean, mean * 1e-6);
+
+    benchmark_register("bounded_median", spin);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(5);
+    set_target_precision(1e-12);
+    set_precision_statistic(PRECISION_MEDIAN);
+    set_sample_count_bounds(0, 300);
+    run_benchmark();
+
+    precision = &benchmark()->testing_results.precision;
+    CHECK(precision->measured);
+    CHECK(!precision->reached);
+    CHECK(precision->samples == 300);
+    CHECK(benchmark()->samples.size > 300);
+
+    samples = &benchmark()->samples;
+    double tracked[300] = {};
+    memcpy(tracked, samples->data + samples->size - 300, sizeof(tracked));
+    CHECK(precision->estimate == select_kth(tracked, 300, 150));
+}
+
+// A steady-state warmup outlasts the slow start of the kernel, and gives up at its bound if never steady.
+static void check_steady_warmup() {
+    benchmark_register("steady_warmup", warming);
+    set_steady_state_warmup(true);
+    set_max_warmup_time(5);
+    set_max_testing_time(0.05);
+    run_benchmark();
+
+    const warmup_results_t* warmup = &benchmark()->warmup_results;
+    CHECK(warmup->steady_state);
+    CHECK(warmup->stabilized);
+    CHECK(warmup->stable_tests > WARMING_CALLS);
+    CHECK(warmup->stable_iterations >= warmup->stable_tests);
+    CHECK(warmup->tests_cnt >= warmup->stable_tests);
+    CHECK((double) warmup->time * benchmark()->ns_per_tick < 5e9);
+
+    // A drift before the minimum time has passed starts the detection over.
+    benchmark_register("relapsing_warmup", relapsing);
+    set_steady_state_warmup(true);
+    set_min_warmup_time(0.3);
+    set_max_warmup_time(5);
+    set_max_testing_time(0.05);
+    run_benchmark();
+
+    warmup = &benchmark()->warmup_results;
+    CHECK(warmup->stabilized);
+    CHECK(warmup->stable_tests > RELAPSE_START + RELAPSE_CALLS);
+
+    benchmark_register("unsteady_warmup", spin);
+    set_steady_state_warmup(true, 1e-12);
+    set_min_warmup_time(0.01);
+    set_max_warmup_time(0.05);
+    set_max_testing_time(0.05);
+    run_benchmark();
+
+    warmup = &benchmark()->warmup_results;
+    CHECK(warmup->steady_state);
+    CHECK(!warmup->stabilized);
+    CHECK(warmup->stable_tests == 0);
+    CHECK(warmup->tests_cnt > 0);
+}
+
+// A run compared with the baseline it just saved has nothing to report; a cut baseline is an error.
+static void check_baseline() {
+    char path[] = "/tmp/test_harness_baseline_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    FILE* out = fopen("/dev/null", "w");
+    compare_config_t config = {COMPARE_WELCH, 0.05, 0.05};
+
+    CHECK(baseline_save(path));
+    CHECK(baseline_compare(path, &config, out) == 0);
+
+    FILE* file = fopen(path, "r+");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    CHECK(truncate(path, size / 2) == 0);
+
+    CHECK(baseline_compare(path, &config, out) < 0);
+
+    fclose(out);
+    unlink(path);
+}
+
+int main() {
+    set_report_file("/dev/null");
+
+    benchmark_register("spin", spin);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(0.05);
+    set_items_per_iteration(1);
+    run_benchmark();
+
+    check_results(benchmark());
+    CHECK(benchmark()->testing_results.items_per_second > 0);
+
+    benchmark_register("paused", paused);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(0.05);
+    run_benchmark();
+
+    check_results(benchmark());
+    CHECK(benchmark()->testing_results.clamped_samples == 0);
+    CHECK(benchmark()->warmup_results.time > 0);
+
+    // The single-threaded baseline doesn't match samples taken through the thread pool.
+    benchmark_register("threaded_baseline", spin);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(0.05);
+    set_threads(2);
+    set_subtract_baseline(true);
+    run_benchmark();
+
+    check_results(benchmark());
+    CHECK(!benchmark()->testing_results.baseline_subtracted);
+
+    // The paused parts of the threads are taken out of the wall time of the sample.
+    benchmark_register("threaded_paused", sleeping);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(0.05);
+    set_threads(2);
+    run_benchmark();
+
+    check_results(benchmark());
+    CHECK(benchmark()->testing_results.average_time * benchmark()->ns_per_tick < PAUSED_SLEEP_NS / 2);
+
+    // The repetitions run in child processes, the parent pools exactly the samples they send.
+    benchmark_register("repeated", spin);
+    set_min_warmup_time(0.01);
+    set_max_testing_time(0.02);
+    set_repetitions(3);
+    run_benchmark();
+
+    check_results(benchmark());
+    CHECK(benchmark()->testing_results.repetitions.repetitions == 3);
+    CHECK(benchmark()->samples.capacity == benchmark()->samples.size);
+
+    check_baseline();
+    check_precision();
+    check_steady_warmup();
+
+    return test_report();
+}
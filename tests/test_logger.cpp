@@ -0,0 +1,309 @@
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "logger.h"
+#include "test.h"
+
+const size_t THREADS_CNT = 4;
+const size_t MESSAGES_PER_THREAD = 2000;
+
+static size_t count_lines(FILE* file, const char* needle) {
+    char line[LOG_RECORD_SIZE] = "";
+    size_t cnt = 0;
+
+    rewind(file);
+    while (fgets(line, sizeof(line), file)) {
+        cnt += strstr(line, needle) != nullptr;
+    }
+
+    return cnt;
+}
+
+static void* log_binary_messages(void*) {
+    for (size_t i = 0; i < MESSAGES_PER_THREAD; i++) {
+        LOG_BINARY(INFO, "binary %zu of %s\n", i, "thread");
+    }
+
+    LoggerFlush();
+    return nullptr;
+}
+
+static void* log_messages(void*) {
+    for (size_t i = 0; i < MESSAGES_PER_THREAD; i++) {
+        LOG(INFO, "message %zu\n", i);
+    }
+
+    return nullptr;
+}
+
+static void test_sync() {
+    FILE* file = tmpfile();
+    LoggerSetFile(file);
+
+    LOG(WARNING, "value %d\n", 42);
+    LOG(DEBUG, "filtered out\n");
+    CHECK(count_lines(file, "value 42") == 1);
+    CHECK(count_lines(file, "[WARNING]") == 1);
+
+    LoggerSetLevel(INFO);
+    LOG(DEBUG, "filtered out\n");
+    CHECK(count_lines(file, "filtered out") == 1);
+    LoggerSetLevel(DEBUG);
+
+    // The record is cut at LOG_RECORD_SIZE instead of overflowing.
+    char long_string[2 * LOG_RECORD_SIZE] = "";
+    memset(long_string, 'x', sizeof(long_string) - 1);
+    LOG(INFO, "%s\n", long_string);
+    CHECK(count_lines(file, "xxx...") == 1);
+
+    // Formats are no longer cut at 100 bytes.
+    LOG(INFO, "a format string that is longer than one hundred bytes, which used to be cut silently, ends with %s\n",
+        "the argument");
+    CHECK(count_lines(file, "ends with the argument") == 1);
+
+    LoggerSetFile(stderr);
+    fclose(file);
+}
+
+static off_t file_size(FILE* file) {
+    struct stat st = {};
+    fstat(fileno(file), &st);
+    return st.st_size;
+}
+
+// Records stay in the stdio buffer until a flush or an error record, unless the file is unbuffered.
+static void test_buffering() {
+    FILE* file = tmpfile();
+    LoggerSetFile(file);
+
+    LOG(INFO, "buffered\n");
+    CHECK(file_size(file) == 0);
+    LoggerFlush();
+    CHECK(file_size(file) > 0);
+
+    off_t flushed = file_size(file);
+    LOG(ERROR, "written through\n");
+    CHECK(file_size(file) > flushed);
+
+    LoggerSetFile(stderr);
+    fclose(file);
+
+    file = tmpfile();
+    LoggerSetFile(file, true);
+
+    LOG(INFO, "unbuffered\n");
+    CHECK(file_size(file) > 0);
+
+    LoggerSetFile(stderr);
+    fclose(file);
+}
+
+// Every message of every thread arrives once the queue is flushed, in one piece.
+static void test_async_block() {
+    FILE* file = tmpfile();
+    LoggerSetFile(file);
+    CHECK(LoggerStartAsync(64, LOG_OVERFLOW_BLOCK));
+
+    pthread_t threads[THREADS_CNT] = {};
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_create(&threads[i], nullptr, log_messages, nullptr);
+    }
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+
+    LoggerFlush();
+    CHECK(count_lines(file, "[INFO]") == THREADS_CNT * MESSAGES_PER_THREAD);
+    CHECK(count_lines(file, "message 1999") == THREADS_CNT);
+
+    LoggerStopAsync();
+    LoggerSetFile(stderr);
+    fclose(file);
+}
+
+// Dropped messages are counted and reported, the rest are written.
+static void test_async_drop() {
+    FILE* file = tmpfile();
+    LoggerSetFile(file);
+    CHECK(LoggerStartAsync(4, LOG_OVERFLOW_DROP));
+
+    log_messages(nullptr);
+    LoggerStopAsync();
+
+    size_t written = count_lines(file, "[INFO]");
+    CHECK(written >= 4);
+    CHECK(written <= MESSAGES_PER_THREAD);
+    if (written < MESSAGES_PER_THREAD) {
+        CHECK(count_lines(file, "log messages dropped") >= 1);
+    }
+
+    // Back to synchronous writes.
+    LOG(INFO, "after stop\n");
+    CHECK(count_lines(file, "after stop") == 1);
+
+    LoggerSetFile(stderr);
+    fclose(file);
+}
+
+// Records rendered from the binary log read as Log() would have written them.
+static void test_binary() {
+    FILE* text = tmpfile();
+    FILE* binary = tmpfile();
+    FILE* decoded = tmpfile();
+    LoggerSetFile(text);
+    CHECK(LoggerSetBinaryFile(binary));
+
+    enum LogLevel level = WARNING;
+    int value = -42;
+    const char* null_string = nullptr;
+    char buffer[] = "hello";
+
+    LOG_BINARY(WARNING, "int %d, unsigned %u, hex %#06x, char %c\n", value, 7u, 255, 'z');
+    LOG_BINARY(ERROR, "double %.3f, float %g, size %zu, enum %d\n", 3.14159, 0.5f, (size_t) 12, level);
+    LOG_BINARY(INFO, "string [%-6s], null %s, percent 100%%\n", "abc", null_string);
+    LOG_BINARY(INFO, "mutable %s %s %d\n", buffer, (const char*) buffer, -5);
+    LOG_BINARY(INFO, "no arguments\n");
+
+    LoggerSetLevel(WARNING);
+    LOG_BINARY(INFO, "filtered out\n");
+    LoggerSetLevel(DEBUG);
+
+    pthread_t threads[THREADS_CNT] = {};
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_create(&threads[i], nullptr, log_binary_messages, nullptr);
+    }
+    for (size_t i = 0; i < THREADS_CNT; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+
+    LoggerFlush();
+    CHECK(count_lines(text, "") == 0);
+
+    rewind(binary);
+    CHECK(LoggerDecodeBinary(binary, decoded));
+
+    CHECK(count_lines(decoded, "int -42, unsigned 7, hex 0x00ff, char z") == 1);
+    CHECK(count_lines(decoded, "double 3.142, float 0.5, size 12, enum 2") == 1);
+    CHECK(count_lines(decoded, "string [abc   ], null , percent 100%") == 1);
+    CHECK(count_lines(decoded, "mutable hello hello -5") == 1);
+    CHECK(count_lines(decoded, "no arguments") == 1);
+    CHECK(count_lines(decoded, "filtered out") == 0);
+    CHECK(count_lines(decoded, "[ERROR]") == 1);
+    CHECK(count_lines(decoded, "of thread") == THREADS_CNT * MESSAGES_PER_THREAD);
+    CHECK(count_lines(decoded, "binary 1999 of thread") == THREADS_CNT);
+
+    // Without a binary file the same sites log text.
+    CHECK(LoggerSetBinaryFile(nullptr));
+    LOG_BINARY(INFO, "no arguments\n");
+    CHECK(count_lines(text, "no arguments") == 1);
+
+    // A record of a site that was never defined means the file is damaged.
+    FILE* damaged = tmpfile();
+    log_binary_header_t header = {7, 0, 0};
+    fwrite(LOG_BINARY_MAGIC, 1, sizeof(LOG_BINARY_MAGIC), damaged);
+    fwrite(&header, sizeof(header), 1, damaged);
+    rewind(damaged);
+    CHECK(!LoggerDecodeBinary(damaged, decoded));
+
+    LoggerSetFile(stderr);
+    fclose(text);
+    fclose(binary);
+    fclose(decoded);
+    fclose(damaged);
+}
+
+static void write_string(FILE* file, const char* string) {
+    uint32_t len = (uint32_t) strlen(string);
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite(string, 1, len, file);
+}
+
+// A binary log with one "%s" site and one record of it, whose string claims string_len characters of which
+// payload_len are there.
+static FILE* corrupted_binary(uint32_t string_len, uint32_t payload_len) {
+    FILE* file = tmpfile();
+    const char* strings[] = {"file.cpp", "func", "%s\n", "s"};
+    uint32_t fields[] = {1, INFO, 10};
+
+    uint32_t site_size = sizeof(fields);
+    for (const char* string : strings) {
+        site_size += (uint32_t) (sizeof(uint32_t) + strlen(string));
+    }
+
+    log_binary_header_t header = {LOG_BINARY_SITE, site_size, 0};
+    fwrite(LOG_BINARY_MAGIC, 1, sizeof(LOG_BINARY_MAGIC), file);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(fields, sizeof(fields), 1, file);
+    for (const char* string : strings) {
+        write_string(file, string);
+    }
+
+    header = {1, (uint32_t) sizeof(string_len) + payload_len, 0};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&string_len, sizeof(string_len), 1, file);
+    for (uint32_t i = 0; i < payload_len; i++) {
+        fputc('a', file);
+    }
+
+    rewind(file);
+    return file;
+}
+
+// String lengths past the record or past what the encoder writes are rejected, not copied.
+static void test_binary_corrupted() {
+    FILE* decoded = tmpfile();
+
+    FILE* valid = corrupted_binary(3, 3);
+    CHECK(LoggerDecodeBinary(valid, decoded));
+    CHECK(count_lines(decoded, "aaa") == 1);
+
+    FILE* oversized = corrupted_binary(8 * LOG_RECORD_SIZE, 8 * LOG_RECORD_SIZE);
+    CHECK(!LoggerDecodeBinary(oversized, decoded));
+
+    FILE* truncated = corrupted_binary(LOG_RECORD_SIZE, 16);
+    CHECK(!LoggerDecodeBinary(truncated, decoded));
+
+    fclose(decoded);
+    fclose(valid);
+    fclose(oversized);
+    fclose(truncated);
+}
+
+static int evaluated = 0;
+
+static int side_effect() {
+    return ++evaluated;
+}
+
+#undef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL WARNING
+
+// Sites below LOG_MIN_LEVEL don't even evaluate their arguments.
+static void test_compile_time_level() {
+    FILE* file = tmpfile();
+    LoggerSetFile(file);
+
+    LOG(INFO, "compiled out %d\n", side_effect());
+    LOG_BINARY(DEBUG, "compiled out %d\n", side_effect());
+    LOG(WARNING, "kept %d\n", side_effect());
+
+    CHECK(evaluated == 1);
+    CHECK(count_lines(file, "compiled out") == 0);
+    CHECK(count_lines(file, "kept 1") == 1);
+
+    LoggerSetFile(stderr);
+    fclose(file);
+}
+
+int main() {
+    test_sync();
+    test_buffering();
+    test_async_block();
+    test_async_drop();
+    test_binary();
+    test_binary_corrupted();
+    test_compile_time_level();
+
+    return test_report();
+}
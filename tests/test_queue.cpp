@@ -0,0 +1,94 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "queue.h"
+#include "test.h"
+
+const size_t HANDOFF_CNT = 100000;
+
+static void test_circ_buffer() {
+    circ_buffer_t buffer = {};
+    CHECK(cb_ctor(&buffer, 4, sizeof(int)) == NO_ERRORS);
+
+    int value = 0;
+    for (int i = 0; i < 3; i++) {
+        cb_push(&buffer, &i);
+    }
+    for (int i = 0; i < 3; i++) {
+        cb_pop(&buffer, &value);
+        CHECK(value == i);
+    }
+
+    // Past the end of the storage, both ends wrap around.
+    for (int i = 0; i < 10; i++) {
+        cb_push(&buffer, &i);
+        cb_pop(&buffer, &value);
+        CHECK(value == i);
+    }
+
+    cb_dtor(&buffer);
+}
+
+static void test_spsc_ring() {
+    spsc_ring_t ring = {};
+    CHECK(spsc_ring_ctor(&ring, 100, sizeof(int)) == NO_ERRORS);
+    CHECK(spsc_ring_capacity(&ring) == 128);
+
+    int value = 0;
+    CHECK(!spsc_ring_pop(&ring, &value));
+
+    for (int i = 0; i < 128; i++) {
+        CHECK(spsc_ring_push(&ring, &i));
+    }
+    CHECK(!spsc_ring_push(&ring, &value));
+    CHECK(spsc_ring_size(&ring) == 128);
+
+    for (int i = 0; i < 128; i++) {
+        CHECK(spsc_ring_pop(&ring, &value));
+        CHECK(value == i);
+    }
+    CHECK(!spsc_ring_pop(&ring, &value));
+
+    spsc_ring_dtor(&ring);
+}
+
+static void* produce(void* arg) {
+    spsc_ring_t* ring = (spsc_ring_t*) arg;
+
+    for (size_t i = 0; i < HANDOFF_CNT; i++) {
+        while (!spsc_ring_push(ring, &i)) {
+            sched_yield();
+        }
+    }
+
+    return nullptr;
+}
+
+static void test_spsc_handoff() {
+    spsc_ring_t ring = {};
+    CHECK(spsc_ring_ctor(&ring, 64, sizeof(size_t)) == NO_ERRORS);
+
+    pthread_t producer;
+    CHECK(pthread_create(&producer, nullptr, produce, &ring) == 0);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < HANDOFF_CNT; i++) {
+        size_t value = 0;
+        while (!spsc_ring_pop(&ring, &value)) {
+            sched_yield();
+        }
+        mismatches += value != i;
+    }
+    CHECK(mismatches == 0);
+
+    pthread_join(producer, nullptr);
+    spsc_ring_dtor(&ring);
+}
+
+int main() {
+    test_circ_buffer();
+    test_spsc_ring();
+    test_spsc_handoff();
+
+    return test_report();
+}
@@ -0,0 +1,187 @@
+#include <math.h>
+
+#include "complexity.h"
+#include "histogram.h"
+#include "stats.h"
+#include "test.h"
+
+static void test_percentile() {
+    const double sorted[] = {1, 2, 3, 4, 5};
+
+    CHECK(percentile(sorted, 5, 0) == 1);
+    CHECK(percentile(sorted, 5, 0.5) == 3);
+    CHECK(percentile(sorted, 5, 1) == 5);
+    CHECK_NEAR(percentile(sorted, 5, 0.125), 1.5, 1e-12);
+}
+
+static void test_statistics() {
+    double samples[100] = {};
+    for (size_t i = 0; i < 100; i++) {
+        samples[i] = (double) (100 - i);
+    }
+
+    statistics_t stats = {};
+    compute_statistics(samples, 100, &stats);
+
+    CHECK(stats.size == 100);
+    CHECK(stats.min == 1);
+    CHECK(stats.max == 100);
+    CHECK_NEAR(stats.mean, 50.5, 1e-12);
+    CHECK_NEAR(stats.median, 50.5, 1e-12);
+    CHECK_NEAR(stats.stddev, 29.011491975882016, 1e-9);
+    CHECK(stats.outliers_low == 0 && stats.outliers_high == 0);
+    CHECK(stats.mean_ci_low <= stats.mean && stats.mean <= stats.mean_ci_high);
+
+    compute_statistics(samples, 100, &stats, false);
+    CHECK(stats.confidence_level == 0 && stats.mean_ci_low == 0 && stats.mean_ci_high == 0);
+}
+
+// Past the bootstrap resample size the mean interval still matches 1.96 standard errors.
+static void test_large_bootstrap() {
+    const size_t size = 200000;
+    samples_t samples = {};
+    CHECK(samples_ctor(&samples, size));
+
+    uint64_t state = 1;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        samples_push(&samples, (double) (state >> 11) / (double) (1ull << 53));
+    }
+
+    statistics_t stats = {};
+    compute_statistics(samples.data, samples.size, &stats);
+
+    double half_width = 1.96 * stats.stddev / sqrt((double) size);
+    CHECK(stats.mean_ci_low < stats.mean && stats.mean < stats.mean_ci_high);
+    CHECK_NEAR(stats.mean_ci_high - stats.mean_ci_low, 2 * half_width, 0.2 * half_width);
+    CHECK(stats.median_ci_low < stats.median && stats.median < stats.median_ci_high);
+
+    samples_dtor(&samples);
+}
+
+static void test_samples() {
+    samples_t samples = {};
+    CHECK(samples_ctor(&samples, 4));
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(samples_push(&samples, i));
+    }
+    CHECK(samples_full(&samples));
+    CHECK(!samples_push(&samples, 4));
+
+    samples_dtor(&samples);
+    CHECK(samples.data == nullptr && samples.size == 0);
+}
+
+static void test_histogram() {
+    static histogram_t histogram = {};
+    static histogram_t other = {};
+
+    for (int i = 1; i <= 1000; i++) {
+        histogram_record(&histogram, i);
+        histogram_record(&other, 1000 + i);
+    }
+
+    CHECK(histogram.total == 1000);
+    CHECK(histogram_percentile(&histogram, 0) == 1);
+    CHECK(histogram_percentile(&histogram, 1) == 1000);
+    CHECK_NEAR(histogram_percentile(&histogram, 0.5), 500, 500 * 0.004);
+    CHECK_NEAR(histogram_mean(&histogram), 500.5, 1e-9);
+
+    histogram_merge(&histogram, &other);
+    CHECK(histogram.total == 2000);
+    CHECK(histogram.max == 2000);
+    CHECK_NEAR(histogram_percentile(&histogram, 0.5), 1000, 1000 * 0.004);
+}
+
+static void test_significance() {
+    const double a[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    const double b[] = {11, 12, 13, 14, 15, 16, 17, 18};
+
+    CHECK(mann_whitney_u_test(a, 8, b, 8) < 0.01);
+    CHECK(mann_whitney_u_test(a, 8, a, 8) > 0.5);
+    CHECK(welch_t_test(10, 1, 30, 10, 1, 30) > 0.99);
+    CHECK(welch_t_test(10, 1, 30, 12, 1, 30) < 0.001);
+}
+
+static void test_quantiles() {
+    CHECK_NEAR(normal_quantile(0.5), 0, 1e-9);
+    CHECK_NEAR(normal_quantile(0.975), 1.959963985, 1e-6);
+    CHECK_NEAR(normal_quantile(0.005), -2.575829304, 1e-6);
+
+    CHECK_NEAR(student_t_quantile(0.975, 1), 12.7062047, 1e-5);
+    CHECK_NEAR(student_t_quantile(0.975, 10), 2.2281389, 1e-6);
+    CHECK_NEAR(student_t_quantile(0.995, 30), 2.7499956, 1e-6);
+    CHECK_NEAR(student_t_quantile(0.025, 10), -2.2281389, 1e-6);
+    CHECK_NEAR(student_t_quantile(0.975, 1e7), 1.959963985, 1e-6);
+}
+
+// For 100 samples the 95% interval spans the order statistics of ranks 40 and 61.
+static void test_median_interval() {
+    double samples[100] = {};
+    for (size_t i = 0; i < 100; i++) {
+        samples[i] = (double) ((i * 37) % 100 + 1);
+    }
+
+    double low = 0;
+    double high = 0;
+    median_confidence_interval(samples, 100, 0.95, &low, &high);
+    CHECK(low == 40);
+    CHECK(high == 61);
+
+    double single = 5;
+    median_confidence_interval(&single, 1, 0.95, &low, &high);
+    CHECK(low == 5 && high == 5);
+}
+
+// Spikes leave the segment medians alone, a step or a trend moves them apart.
+static void test_segment_drift() {
+    double series[64] = {};
+
+    for (size_t i = 0; i < 64; i++) {
+        series[i] = i % 10 ? 100 : 1000;
+    }
+    CHECK(segment_drift(series, 64, 4) == 0);
+
+    for (size_t i = 0; i < 64; i++) {
+        series[i] = i < 32 ? 100 : 110;
+    }
+    CHECK_NEAR(segment_drift(series, 64, 4), 0.1, 1e-12);
+
+    for (size_t i = 0; i < 64; i++) {
+        series[i] = 100 + (double) i;
+    }
+    CHECK_NEAR(segment_drift(series, 64, 4), 48 / 107.5, 1e-12);
+}
+
+// A point at n = 0 must not turn the log curves into NaN and poison the automatic choice.
+static void test_complexity_zero() {
+    const int64_t n[] = {0, 1, 2, 4, 8, 16, 32, 64};
+    double time[8] = {};
+
+    for (size_t i = 0; i < 8; i++) {
+        time[i] = 3 * (double) n[i] * log2(fmax((double) n[i], 1)) + 1e-9;
+    }
+
+    complexity_fit_t fit = fit_complexity(n, time, 8, O_LOG_N);
+    CHECK(isfinite(fit.coefficient) && isfinite(fit.rms));
+
+    fit = fit_complexity(n, time, 8, COMPLEXITY_AUTO);
+    CHECK(fit.complexity == O_N_LOG_N);
+    CHECK_NEAR(fit.coefficient, 3, 1e-6);
+}
+
+int main() {
+    test_percentile();
+    test_statistics();
+    test_large_bootstrap();
+    test_samples();
+    test_histogram();
+    test_significance();
+    test_quantiles();
+    test_median_interval();
+    test_segment_drift();
+    test_complexity_zero();
+
+    return test_report();
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "thread_pool.h"
+#include "test.h"
+
+const size_t POOL_THREADS = 4;
+const size_t POOL_RUNS = 100;
+const size_t FAILING_POOL_THREADS = 64;
+const size_t ADDRESS_SPACE_SLACK = 32 << 20;   // a few thread stacks
+const unsigned STARTUP_TIMEOUT = 10;           // s
+
+static ticks_t count_runs(size_t thread_index, void* arg) {
+    size_t* runs = (size_t*) arg;
+    runs[thread_index]++;
+    return 1;
+}
+
+static void test_runs() {
+    size_t runs[POOL_THREADS] = {};
+    thread_pool_t pool = {};
+
+    CHECK(thread_pool_ctor(&pool, POOL_THREADS, count_runs, runs));
+
+    for (size_t i = 0; i < POOL_RUNS; i++) {
+        thread_pool_run(&pool);
+    }
+
+    for (size_t i = 0; i < POOL_THREADS; i++) {
+        CHECK(runs[i] == POOL_RUNS);
+        CHECK(pool.totals[i] == POOL_RUNS);
+    }
+
+    thread_pool_dtor(&pool);
+}
+
+static size_t address_space() {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+
+    size_t pages = 0;
+    if (fscanf(file, "%zu", &pages) != 1) {
+        pages = 0;
+    }
+
+    fclose(file);
+    return pages * (size_t) sysconf(_SC_PAGESIZE);
+}
+
+// Thread stacks stop fitting into the limited address space after a few workers. The pool has to give up
+// and return, a hang is killed by the alarm.
+static void test_failed_startup() {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0) {
+        alarm(STARTUP_TIMEOUT);
+
+        struct rlimit limit = {};
+        getrlimit(RLIMIT_AS, &limit);
+        limit.rlim_cur = address_space() + ADDRESS_SPACE_SLACK;
+        if (setrlimit(RLIMIT_AS, &limit)) {
+            _exit(2);
+        }
+
+        size_t runs[FAILING_POOL_THREADS] = {};
+        thread_pool_t pool = {};
+        bool started = thread_pool_ctor(&pool, FAILING_POOL_THREADS, count_runs, runs);
+
+        _exit(started ? 1 : 0);
+    }
+
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main() {
+    test_runs();
+    test_failed_startup();
+
+    return test_report();
+}
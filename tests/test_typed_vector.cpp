@@ -0,0 +1,73 @@
+#include <string>
+
+#include "test.h"
+#include "typed_vector.h"
+
+static void test_trivial() {
+    vector<double> values;
+    CHECK(values.empty());
+
+    for (int i = 0; i < 100; i++) {
+        CHECK(values.push_back(i));
+    }
+    CHECK(values.size == 100);
+    CHECK(values.capacity == 128);
+    CHECK(values[99] == 99);
+
+    double sum = 0;
+    for (double value : values) {
+        sum += value;
+    }
+    CHECK(sum == 4950);
+
+    double popped = 0;
+    CHECK(values.pop_back(&popped));
+    CHECK(popped == 99);
+    CHECK(values.size == 99);
+}
+
+static void test_non_trivial() {
+    vector<std::string> strings;
+
+    for (int i = 0; i < 1000; i++) {
+        CHECK(strings.emplace_back(std::to_string(i)));
+    }
+    CHECK(strings[999] == "999");
+
+    vector<std::string> copy(strings);
+    vector<std::string> moved(static_cast<vector<std::string>&&>(strings));
+
+    CHECK(strings.size == 0 && strings.data == nullptr);
+    CHECK(copy.size == 1000 && copy[7] == "7");
+    CHECK(moved.size == 1000 && moved[500] == "500");
+
+    copy = moved;
+    CHECK(copy.size == 1000 && copy[1] == "1");
+}
+
+static void test_arena() {
+    arena_t arena = {};
+    CHECK(arena_ctor(&arena, 1 << 16, false));
+
+    {
+        vector<double> values(&arena);
+        CHECK(values.reserve(1000));
+        CHECK((char*) values.data >= arena.base && (char*) values.data < arena.base + arena.size);
+
+        for (int i = 0; i < 1000; i++) {
+            values.push_back(i);
+        }
+        CHECK(values[999] == 999);
+        CHECK(!values.reserve(1 << 20));
+    }
+
+    arena_dtor(&arena);
+}
+
+int main() {
+    test_trivial();
+    test_non_trivial();
+    test_arena();
+
+    return test_report();
+}
@@ -0,0 +1,85 @@
+#include <stdint.h>
+
+#include "test.h"
+#include "vector.h"
+
+static void test_push_pop() {
+    vector_t* vec = new_vector(sizeof(int64_t));
+    CHECK(vec);
+
+    for (int64_t i = 0; i < 100; i++) {
+        CHECK(vector_push_back(vec, &i) == OK);
+    }
+    CHECK(vector_elms_cnt(vec) == 100);
+    CHECK(vector_capacity_elms(vec) >= 100);
+    CHECK(vector_head_ptr(vec) == (char*) vec->data + 100 * sizeof(int64_t));
+
+    int64_t value = -1;
+    CHECK(vector_pop_back(vec, &value) == OK);
+    CHECK(value == 99);
+    CHECK(vector_elms_cnt(vec) == 99);
+
+    vector_at(vec, &value, 42);
+    CHECK(value == 42);
+
+    vector_clear(vec);
+    CHECK(vector_is_empty(vec) == 1);
+    CHECK(vector_pop_back(vec, &value) == EMPTY_VECTOR);
+
+    vector_delete(vec);
+}
+
+static void test_insert_erase() {
+    vector_t* vec = new_vector(sizeof(int64_t));
+
+    for (int64_t i = 0; i < 10; i++) {
+        vector_push_back(vec, &i);
+    }
+
+    int64_t inserted = 42;
+    int64_t value = -1;
+
+    vector_insert_at(vec, 3, &inserted);
+    CHECK(vector_elms_cnt(vec) == 11);
+    vector_at(vec, &value, 3);
+    CHECK(value == 42);
+    vector_at(vec, &value, 4);
+    CHECK(value == 3);
+
+    vector_erase_at(vec, 3);
+    CHECK(vector_elms_cnt(vec) == 10);
+    vector_at(vec, &value, 3);
+    CHECK(value == 3);
+
+    vector_erase_elms(vec, 2, 5);
+    CHECK(vector_elms_cnt(vec) == 7);
+    vector_at(vec, &value, 2);
+    CHECK(value == 5);
+    vector_at(vec, &value, 6);
+    CHECK(value == 9);
+
+    vector_delete(vec);
+}
+
+static void test_reserve_shrink() {
+    vector_t* vec = new_vector(sizeof(int64_t));
+
+    CHECK(vector_reserve_elms(vec, 64) == OK);
+    CHECK(vector_capacity_elms(vec) == 64);
+
+    for (int64_t i = 0; i < 5; i++) {
+        vector_push_back(vec, &i);
+    }
+    CHECK(vector_shrink_to_fit(vec) == OK);
+    CHECK(vector_capacity_elms(vec) == 5);
+
+    vector_delete(vec);
+}
+
+int main() {
+    test_push_pop();
+    test_insert_erase();
+    test_reserve_shrink();
+
+    return test_report();
+}
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "logger.h"
+
+static void* worker_loop(void* arg);
+static void release_workers(thread_pool_t* pool, bool stop);
+static void free_pool(thread_pool_t* pool);
+
+//============================================================================================================
+
+size_t hardware_concurrency() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t) cpus : 1;
+}
+
+// The calling thread takes part in every run as thread 0, so a pool of N threads starts N - 1 workers.
+bool thread_pool_ctor(thread_pool_t* pool, size_t threads, thread_task_t task, void* arg) {
+    assert(pool);
+    assert(threads != 0);
+    assert(task);
+
+    memset(pool, 0, sizeof(thread_pool_t));
+
+    pool->threads = threads;
+    pool->task = task;
+    pool->arg = arg;
+
+    pool->workers = (pthread_t*) calloc(threads, sizeof(pthread_t));
+    pool->worker_args = (worker_arg_t*) calloc(threads, sizeof(worker_arg_t));
+    pool->times = (ticks_t*) calloc(threads, sizeof(ticks_t));
+    pool->totals = (ticks_t*) calloc(threads, sizeof(ticks_t));
+
+    if (!pool->workers || !pool->worker_args || !pool->times || !pool->totals) {
+        LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+        free(pool->workers);
+        free(pool->worker_args);
+        free(pool->times);
+        free(pool->totals);
+        memset(pool, 0, sizeof(thread_pool_t));
+        return false;
+    }
+
+    pthread_barrier_init(&pool->start_barrier, nullptr, (unsigned) threads);
+    pthread_barrier_init(&pool->end_barrier, nullptr, (unsigned) threads);
+    pthread_mutex_init(&pool->startup_lock, nullptr);
+    pthread_cond_init(&pool->startup_cond, nullptr);
+
+    for (size_t i = 1; i < threads; i++) {
+        pool->worker_args[i] = {pool, i};
+
+        int error = pthread_create(&pool->workers[i], nullptr, worker_loop, &pool->worker_args[i]);
+        if (error) {
+            LOG(ERROR, "Can't start benchmark thread: %s\n", strerror(error));
+
+            // The started workers haven't reached the barriers yet and leave without them.
+            release_workers(pool, true);
+            for (size_t j = 1; j < i; j++) {
+                pthread_join(pool->workers[j], nullptr);
+            }
+
+            free_pool(pool);
+            return false;
+        }
+    }
+
+    release_workers(pool, false);
+    return true;
+}
+
+void thread_pool_dtor(thread_pool_t* pool) {
+    assert(pool);
+
+    if (!pool->workers) {
+        return;
+    }
+
+    // All workers are started and wait on the start barrier; release them with stop set.
+    if (pool->threads > 1) {
+        pool->stop = true;
+        pthread_barrier_wait(&pool->start_barrier);
+
+        for (size_t i = 1; i < pool->threads; i++) {
+            pthread_join(pool->workers[i], nullptr);
+        }
+    }
+
+    free_pool(pool);
+}
+
+// Releases all threads at once from the start barrier and returns the wall time until the last
+// one has finished, as seen by thread 0. Per-thread times are left in pool->times.
+ticks_t thread_pool_run(thread_pool_t* pool) {
+    assert(pool);
+
+    pthread_barrier_wait(&pool->start_barrier);
+    ticks_t start = timer_start();
+
+    pool->times[0] = pool->task(0, pool->arg);
+
+    pthread_barrier_wait(&pool->end_barrier);
+    ticks_t end = timer_stop();
+
+    for (size_t i = 0; i < pool->threads; i++) {
+        pool->totals[i] += pool->times[i];
+    }
+
+    return end - start;
+}
+
+void thread_pool_reset_totals(thread_pool_t* pool) {
+    assert(pool);
+
+    memset(pool->totals, 0, pool->threads * sizeof(ticks_t));
+}
+
+//============================================================================================================
+
+static void* worker_loop(void* arg) {
+    worker_arg_t* worker = (worker_arg_t*) arg;
+    thread_pool_t* pool = worker->pool;
+
+    pthread_mutex_lock(&pool->startup_lock);
+    while (!pool->started && !pool->stop) {
+        pthread_cond_wait(&pool->startup_cond, &pool->startup_lock);
+    }
+    bool stop = pool->stop;
+    pthread_mutex_unlock(&pool->startup_lock);
+
+    if (stop) {
+        return nullptr;
+    }
+
+    while (true) {
+        pthread_barrier_wait(&pool->start_barrier);
+        if (pool->stop) {
+            break;
+        }
+
+        pool->times[worker->index] = pool->task(worker->index, pool->arg);
+
+        pthread_barrier_wait(&pool->end_barrier);
+    }
+
+    return nullptr;
+}
+
+static void release_workers(thread_pool_t* pool, bool stop) {
+    pthread_mutex_lock(&pool->startup_lock);
+    pool->started = !stop;
+    pool->stop = stop;
+    pthread_cond_broadcast(&pool->startup_cond);
+    pthread_mutex_unlock(&pool->startup_lock);
+}
+
+static void free_pool(thread_pool_t* pool) {
+    pthread_barrier_destroy(&pool->start_barrier);
+    pthread_barrier_destroy(&pool->end_barrier);
+    pthread_mutex_destroy(&pool->startup_lock);
+    pthread_cond_destroy(&pool->startup_cond);
+
+    free(pool->workers);
+    free(pool->worker_args);
+    free(pool->times);
+    free(pool->totals);
+    memset(pool, 0, sizeof(thread_pool_t));
+}
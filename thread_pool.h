@@ -0,0 +1,46 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+#include "timer.h"
+
+typedef ticks_t (*thread_task_t) (size_t thread_index, void* arg);
+
+struct thread_pool_t;
+
+typedef struct {
+    struct thread_pool_t* pool;
+    size_t index;
+} worker_arg_t;
+
+typedef struct thread_pool_t {
+    size_t threads;
+    pthread_t* workers;
+    worker_arg_t* worker_args;
+
+    pthread_barrier_t start_barrier;
+    pthread_barrier_t end_barrier;
+
+    // Workers wait here until every one of them is started, the barriers need the full pool.
+    pthread_mutex_t startup_lock;
+    pthread_cond_t startup_cond;
+    bool started;
+
+    thread_task_t task;
+    void* arg;
+    bool stop;
+
+    ticks_t* times;
+    ticks_t* totals;
+} thread_pool_t;
+
+size_t hardware_concurrency();
+
+bool thread_pool_ctor(thread_pool_t* pool, size_t threads, thread_task_t task, void* arg);
+void thread_pool_dtor(thread_pool_t* pool);
+
+ticks_t thread_pool_run(thread_pool_t* pool);
+void thread_pool_reset_totals(thread_pool_t* pool);
+
+#endif /* THREAD_POOL_H */
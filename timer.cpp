@@ -0,0 +1,122 @@
+#include <assert.h>
+
+#include "timer.h"
+#include "logger.h"
+
+#if TIMER_HAS_TSC
+#include <cpuid.h>
+#endif
+
+static double calibrate_tsc();
+static bool tsc_is_invariant();
+
+//============================================================================================================
+
+const ticks_t TSC_CALIBRATION_TIME = 50000000;
+const size_t  TSC_CALIBRATION_ROUNDS = 3;
+
+//============================================================================================================
+
+void timer_set_backend(timer_backend_t backend) {
+    if (backend == TIMER_TSC && !TIMER_HAS_TSC) {
+        LOG(WARNING, "TSC timer is not available on this architecture, falling back to CLOCK_MONOTONIC_RAW\n");
+        backend = TIMER_MONOTONIC_RAW;
+    }
+
+    timer_config()->backend = backend;
+    timer_config()->ns_per_tick = 1.0;
+
+    // Calibrated once per process, forked repetitions inherit it.
+    if (backend == TIMER_TSC) {
+        static double tsc_ns_per_tick = 0;
+
+        if (tsc_ns_per_tick == 0) {
+            if (!tsc_is_invariant()) {
+                LOG(WARNING, "TSC is not invariant, cycle counts may drift with frequency changes\n");
+            }
+
+            tsc_ns_per_tick = calibrate_tsc();
+        }
+
+        timer_config()->ns_per_tick = tsc_ns_per_tick;
+    }
+}
+
+timer_backend_t timer_backend() {
+    return timer_config()->backend;
+}
+
+double timer_ticks_to_ns(double ticks) {
+    return ticks * timer_config()->ns_per_tick;
+}
+
+ticks_t timer_ns_to_ticks(double ns) {
+    return (ticks_t) (ns / timer_config()->ns_per_tick);
+}
+
+const char* timer_units() {
+    return timer_backend_units(timer_config()->backend);
+}
+
+const char* timer_backend_units(timer_backend_t backend) {
+    return backend == TIMER_TSC ? "cycles" : "ns";
+}
+
+const char* timer_backend_name(timer_backend_t backend) {
+    switch (backend) {
+        case TIMER_MONOTONIC_RAW:
+            return "monotonic_raw";
+        case TIMER_THREAD_CPUTIME:
+            return "thread_cputime";
+        case TIMER_TSC:
+            return "tsc";
+        default:
+            assert(0 && "Undefined timer backend");
+            return "unknown";
+    }
+}
+
+//============================================================================================================
+
+// Counts TSC ticks against CLOCK_MONOTONIC_RAW over a short busy wait; the smallest
+// ratio of several rounds is kept, since preemption can only stretch a round.
+static double calibrate_tsc() {
+#if TIMER_HAS_TSC
+    double ns_per_tick = 0;
+
+    for (size_t i = 0; i < TSC_CALIBRATION_ROUNDS; i++) {
+        ticks_t ns_start = timer_clock_ns(CLOCK_MONOTONIC_RAW);
+        ticks_t tsc_start = timer_start();
+
+        ticks_t ns_end = ns_start;
+        while (ns_end - ns_start < TSC_CALIBRATION_TIME) {
+            ns_end = timer_clock_ns(CLOCK_MONOTONIC_RAW);
+        }
+
+        ticks_t tsc_end = timer_stop();
+
+        double ratio = (double) (ns_end - ns_start) / (double) (tsc_end - tsc_start);
+        if (ns_per_tick == 0 || ratio < ns_per_tick) {
+            ns_per_tick = ratio;
+        }
+    }
+
+    return ns_per_tick;
+#else
+    return 1.0;
+#endif
+}
+
+static bool tsc_is_invariant() {
+#if TIMER_HAS_TSC
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+
+    return edx & (1 << 8);
+#else
+    return false;
+#endif
+}
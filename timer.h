@@ -0,0 +1,88 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_HAS_TSC 1
+#else
+#define TIMER_HAS_TSC 0
+#endif
+
+typedef uint64_t ticks_t;
+
+typedef enum {
+    TIMER_MONOTONIC_RAW  = 0,
+    TIMER_THREAD_CPUTIME = 1,
+    TIMER_TSC            = 2,
+} timer_backend_t;
+
+typedef struct {
+    timer_backend_t backend;
+    double ns_per_tick;
+} timer_config_t;
+
+//============================================================================================================
+
+inline timer_config_t* timer_config() {
+    static timer_config_t config = {TIMER_MONOTONIC_RAW, 1.0};
+    return &config;
+}
+
+inline ticks_t timer_clock_ns(clockid_t clock_id) {
+    struct timespec ts = {};
+    clock_gettime(clock_id, &ts);
+    return (ticks_t) ts.tv_sec * 1000000000 + (ticks_t) ts.tv_nsec;
+}
+
+// Serialized so that neither earlier nor later instructions leak into the measured region:
+// lfence before rdtsc waits for preceding instructions, rdtscp waits for the measured ones.
+inline ticks_t timer_start() {
+    switch (timer_config()->backend) {
+#if TIMER_HAS_TSC
+        case TIMER_TSC: {
+            _mm_lfence();
+            ticks_t ticks = __rdtsc();
+            _mm_lfence();
+            return ticks;
+        }
+#endif
+        case TIMER_THREAD_CPUTIME:
+            return timer_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        default:
+            return timer_clock_ns(CLOCK_MONOTONIC_RAW);
+    }
+}
+
+inline ticks_t timer_stop() {
+    switch (timer_config()->backend) {
+#if TIMER_HAS_TSC
+        case TIMER_TSC: {
+            unsigned int aux = 0;
+            ticks_t ticks = __rdtscp(&aux);
+            _mm_lfence();
+            return ticks;
+        }
+#endif
+        case TIMER_THREAD_CPUTIME:
+            return timer_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        default:
+            return timer_clock_ns(CLOCK_MONOTONIC_RAW);
+    }
+}
+
+//============================================================================================================
+
+void timer_set_backend(timer_backend_t backend);
+timer_backend_t timer_backend();
+
+double timer_ticks_to_ns(double ticks);
+ticks_t timer_ns_to_ticks(double ns);
+
+const char* timer_units();
+const char* timer_backend_units(timer_backend_t backend);
+const char* timer_backend_name(timer_backend_t backend);
+
+#endif /* TIMER_H */
@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "flight_recorder.h"
+
+// Prints the records kept in a flight recorder file, oldest first.
+//
+//     flight_recorder_dump crash.flight [N]
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s FLIGHT_RECORDER [LAST_N]\n", argv[0]);
+        return 1;
+    }
+
+    size_t cnt = argc == 3 ? (size_t) atol(argv[2]) : 0;
+
+    return flight_recorder_dump(argv[1], cnt, stdout) ? 0 : 2;
+}
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "logger.h"
+
+// Renders a binary log written through LOG_BINARY() as text.
+//
+//     log_decoder run.binlog [out.log]
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s BINARY_LOG [OUTPUT]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Can't open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Can't open %s: %s\n", argv[2], strerror(errno));
+        fclose(in);
+        return 1;
+    }
+
+    bool decoded = LoggerDecodeBinary(in, out);
+
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    return decoded ? 0 : 2;
+}
@@ -0,0 +1,250 @@
+#ifndef TYPED_VECTOR_H
+#define TYPED_VECTOR_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "arena.h"
+#include "logger.h"
+
+// Typed replacement of vector_t: sizes and capacities are counted in elements, elements are constructed
+// in place and moved on growth. Trivially copyable elements are grown with realloc and copied with memcpy.
+//
+// The members are public and an all-zero vector is a valid empty one, so it can live in structures that
+// are calloc'd like benchmark_t. Allocation failures are logged and reported by a false return, as in the
+// rest of the library.
+//
+// A vector constructed with an arena takes its storage from it and never frees it; growth leaves the old
+// block behind, so such vectors should be reserved once.
+
+const size_t VECTOR_MIN_CAPACITY = 8;
+const size_t VECTOR_GROWTH_FACTOR = 2;
+
+template <typename T>
+struct vector {
+    T* data;
+    size_t size;
+    size_t capacity;
+    arena_t* arena;
+
+    vector() : data(nullptr), size(0), capacity(0), arena(nullptr) {}
+
+    explicit vector(arena_t* arena) : data(nullptr), size(0), capacity(0), arena(arena) {}
+
+    vector(const vector& other) : data(nullptr), size(0), capacity(0), arena(nullptr) {
+        if (reserve(other.size)) {
+            append(other.data, other.size);
+        }
+    }
+
+    vector(vector&& other) noexcept
+        : data(other.data), size(other.size), capacity(other.capacity), arena(other.arena) {
+        other.data = nullptr;
+        other.size = 0;
+        other.capacity = 0;
+    }
+
+    ~vector() {
+        release();
+    }
+
+    vector& operator=(const vector& other) {
+        if (this != &other) {
+            clear();
+            if (reserve(other.size)) {
+                append(other.data, other.size);
+            }
+        }
+        return *this;
+    }
+
+    vector& operator=(vector&& other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    //========================================================================================================
+
+    T& operator[](size_t index) {
+        return data[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return data[index];
+    }
+
+    T* begin() {
+        return data;
+    }
+
+    T* end() {
+        return data + size;
+    }
+
+    const T* begin() const {
+        return data;
+    }
+
+    const T* end() const {
+        return data + size;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    T& back() {
+        return data[size - 1];
+    }
+
+    //========================================================================================================
+
+    bool push_back(const T& value) {
+        return emplace_back(value);
+    }
+
+    bool push_back(T&& value) {
+        return emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    bool emplace_back(Args&&... args) {
+        if (size == capacity && !grow(size + 1)) {
+            return false;
+        }
+
+        new (data + size) T(std::forward<Args>(args)...);
+        size++;
+        return true;
+    }
+
+    bool pop_back(T* dst) {
+        if (!size) {
+            return false;
+        }
+
+        size--;
+        *dst = std::move(data[size]);
+        data[size].~T();
+        return true;
+    }
+
+    bool append(const T* values, size_t cnt) {
+        if (size + cnt > capacity && !grow(size + cnt)) {
+            return false;
+        }
+
+        if (std::is_trivially_copyable<T>::value) {
+            if (cnt) {
+                memcpy((void*) (data + size), values, cnt * sizeof(T));
+            }
+        }
+        else {
+            for (size_t i = 0; i < cnt; i++) {
+                new (data + size + i) T(values[i]);
+            }
+        }
+
+        size += cnt;
+        return true;
+    }
+
+    // Allocates exactly new_capacity elements, unlike the geometric growth of the push functions.
+    bool reserve(size_t new_capacity) {
+        if (new_capacity <= capacity) {
+            return true;
+        }
+
+        return reallocate(new_capacity);
+    }
+
+    void clear() {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (size_t i = 0; i < size; i++) {
+                data[i].~T();
+            }
+        }
+
+        size = 0;
+    }
+
+    void swap(vector& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(capacity, other.capacity);
+        std::swap(arena, other.arena);
+    }
+
+    //========================================================================================================
+
+private:
+    bool grow(size_t min_capacity) {
+        size_t new_capacity = capacity ? capacity * VECTOR_GROWTH_FACTOR : VECTOR_MIN_CAPACITY;
+        while (new_capacity < min_capacity) {
+            new_capacity *= VECTOR_GROWTH_FACTOR;
+        }
+
+        return reallocate(new_capacity);
+    }
+
+    bool reallocate(size_t new_capacity) {
+        bool trivial = std::is_trivially_copyable<T>::value;
+        T* new_data = nullptr;
+
+        if (arena) {
+            new_data = (T*) arena_alloc(arena, new_capacity * sizeof(T), alignof(T));
+        }
+        else if (trivial) {
+            new_data = (T*) realloc((void*) data, new_capacity * sizeof(T));
+        }
+        else {
+            new_data = (T*) malloc(new_capacity * sizeof(T));
+        }
+
+        if (!new_data && arena) {
+            LOG(ERROR, "Arena of %zu bytes is exhausted\n", arena->size);
+            return false;
+        }
+        if (!new_data) {
+            LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
+            return false;
+        }
+
+        if (arena && trivial && size) {
+            memcpy((void*) new_data, data, size * sizeof(T));
+        }
+        else if (!trivial) {
+            for (size_t i = 0; i < size; i++) {
+                new (new_data + i) T(std::move(data[i]));
+                data[i].~T();
+            }
+        }
+
+        if (!arena && !trivial) {
+            free(data);
+        }
+
+        data = new_data;
+        capacity = new_capacity;
+        return true;
+    }
+
+    void release() {
+        clear();
+        if (!arena) {
+            free((void*) data);
+        }
+
+        data = nullptr;
+        capacity = 0;
+    }
+};
+
+#endif /* TYPED_VECTOR_H */
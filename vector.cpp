@@ -66,13 +66,13 @@ vec_err_t vector_push_back(vector_t* vector, void* src) {
 	assert(vector != nullptr);
 	assert(src != nullptr);
 
-	vec_err_t memory_add_status = memory_add_to_fit(vector, vector->size + 1);
+	vec_err_t memory_add_status = memory_add_to_fit_elms(vector, 1);
 	if (memory_add_status != OK) {
 		return memory_add_status;
 	}
 
-	memcpy((char*) vector->data + vector->size, src,  vector->elm_width);
-	vector->size += vector->elm_width;
+	memcpy((char*) vector->data + vector->size * vector->elm_width, src, vector->elm_width);
+	vector->size++;
 	return OK;
 }
 
@@ -80,50 +80,44 @@ vec_err_t vector_pop_back(vector_t* vec, void* dst) {
 	assert(vec != nullptr);
 	assert(dst != nullptr);
 
-	if (vec->size <  vec->elm_width) {
+	if (vec->size == 0) {
 		return EMPTY_VECTOR;
 	}
 
-	memcpy(dst, (char*) vec->data + vec->size - vec->elm_width, vec->elm_width);
-	memset((char*) vec->data + vec->size - vec->elm_width, 0, vec->elm_width);
-	vec->size -=  vec->elm_width;
+	vec->size--;
+	memcpy(dst, (char*) vec->data + vec->size * vec->elm_width, vec->elm_width);
+	memset((char*) vec->data + vec->size * vec->elm_width, 0, vec->elm_width);
 	return OK;
 }
 
 //============================================================================================
 
-bool vector_has_space(vector_t* vec, size_t len) {
+bool vector_has_space_elms(vector_t* vec, size_t len) {
 	assert(vec != nullptr);
 
 	return vec->capacity >= (vec->size + len);
 }
 
-vec_err_t memory_add_to_fit(vector_t* vec, size_t len) {
+vec_err_t memory_add_to_fit_elms(vector_t* vec, size_t len) {
 	assert(vec != nullptr);
 
-	if (vector_has_space(vec, len)) {
+	if (vector_has_space_elms(vec, len)) {
 		return OK;
 	}
 
+	size_t new_capacity = vec->capacity ? vec->capacity : 1;
 	do {
-		vec->capacity *= 2;
-	} while (!vector_has_space(vec, len));
+		new_capacity *= 2;
+	} while (new_capacity < vec->size + len);
 
-	void* new_data = realloc(vec->data, vec->capacity);
-	if (new_data == nullptr) {
-		LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
-		return MEMORY_ALLOCATION_ERROR;
-	}
-
-	vec->data = new_data;
-	return OK;
+	return memory_add_elms(vec, new_capacity);
 }
 
-vec_err_t memory_add(vector_t* vec, size_t new_capacity) {
+vec_err_t memory_add_elms(vector_t* vec, size_t new_capacity) {
 	assert(vec != nullptr);
 	assert(new_capacity != 0);
 
-	void* new_data = realloc(vec->data, new_capacity);
+	void* new_data = realloc(vec->data, new_capacity * vec->elm_width);
 	if (new_data == nullptr) {
 		LOG(ERROR, "Memory allocation error\n" STRERROR(errno));
 		return MEMORY_ALLOCATION_ERROR;
@@ -134,43 +128,55 @@ vec_err_t memory_add(vector_t* vec, size_t new_capacity) {
 	return OK;
 }
 
-vec_err_t vector_reserve(vector_t* vector, size_t new_capacity) {
+vec_err_t vector_reserve_elms(vector_t* vector, size_t new_capacity) {
 	assert(vector != nullptr);
 
 	if (vector->capacity >= new_capacity) {
 		return OK;
 	}
 
-    return memory_add(vector, new_capacity);
+    return memory_add_elms(vector, new_capacity);
 }
 
 vec_err_t vector_shrink_to_fit(vector_t* vector) {
 	assert(vector != nullptr);
 
-	return memory_add(vector, vector->size);
+	return vector->size ? memory_add_elms(vector, vector->size) : OK;
 }
 
 //============================================================================================
 
-void vector_insert(vector_t* vec, size_t pos, void* elm, size_t elm_width) {
+void vector_insert_at(vector_t* vec, size_t pos, void* elm) {
 	assert(vec != nullptr);
 	assert(elm != nullptr);
-	assert(elm_width != 0);
 
-	memcpy((char*) vec->data + (pos - 1) * elm_width, elm, vec->size - pos * elm_width);
+	if (pos > vec->size || memory_add_to_fit_elms(vec, 1) != OK) {
+		return;
+	}
+
+	char* slot = (char*) vec->data + pos * vec->elm_width;
+
+	memmove(slot + vec->elm_width, slot, (vec->size - pos) * vec->elm_width);
+	memcpy(slot, elm, vec->elm_width);
+	vec->size++;
 }
 
-void vector_erase_elm(vector_t* vec, size_t pos, size_t elm_width) {
+void vector_erase_at(vector_t* vec, size_t pos) {
 	assert(vec != nullptr);
-	assert(elm_width != 0);
 
-    memcpy((char*) vec->data + (pos - 1) * elm_width, vec->data, vec->size - pos * elm_width);
-	vec->size -= elm_width;
+	if (pos >= vec->size) {
+		return;
+	}
+
+	char* slot = (char*) vec->data + pos * vec->elm_width;
 
-	memset((char*) vec->data + vec->size, 0, elm_width);
+	memmove(slot, slot + vec->elm_width, (vec->size - pos - 1) * vec->elm_width);
+	vec->size--;
+
+	memset((char*) vec->data + vec->size * vec->elm_width, 0, vec->elm_width);
 }
 
-void vector_erase_range(vector_t* vec, size_t first, size_t last) {
+void vector_erase_elms(vector_t* vec, size_t first, size_t last) {
 	assert(vec != nullptr);
 
 	if (last == first) {
@@ -182,17 +188,24 @@ void vector_erase_range(vector_t* vec, size_t first, size_t last) {
 		last = new_last;
 	}
 
-	memcpy((char*) vec->data + (first - 1) *  vec->elm_width, (char*) vec->data + last *  vec->elm_width,
-		    vec->size - last *  vec->elm_width);
-	vec->size -=  vec->elm_width * (1 + last - first);
+	if (last > vec->size) {
+		last = vec->size;
+	}
+	if (first >= last) {
+		return;
+	}
+
+	memmove((char*) vec->data + first * vec->elm_width, (char*) vec->data + last * vec->elm_width,
+		    (vec->size - last) * vec->elm_width);
+	vec->size -= last - first;
 
-	memset((char*) vec->data + vec->size, 0,  vec->elm_width * (1 + last - first));
+	memset((char*) vec->data + vec->size * vec->elm_width, 0, (last - first) * vec->elm_width);
 }
 
 void vector_clear(vector_t* vector) {
 	assert(vector != nullptr);
 
-	memset(vector->data, 0, vector->size);
+	memset(vector->data, 0, vector->size * vector->elm_width);
 	vector->size = 0;
 }
 
@@ -200,11 +213,11 @@ void vector_at(vector_t* vector, void* dst, size_t index) {
 	assert(vector != nullptr);
 	assert(dst != nullptr);
 
-	if (index > vector->size) {
+	if (index >= vector->size) {
 		return;
 	}
 
-	memcpy(dst, vector->data, vector->elm_width);
+	memcpy(dst, (char*) vector->data + index * vector->elm_width, vector->elm_width);
 }
 
 //============================================================================================
@@ -219,12 +232,12 @@ void* vector_element_ptr(vector_t* vec, size_t n) {
 	return (char*) vec->data + (vec->elm_width * n);
 }
 
-size_t vector_size(vector_t* vec) {
+size_t vector_elms_cnt(vector_t* vec) {
 	assert(vec != nullptr);
 	return vec->size;
 }
 
-size_t vector_capacity(vector_t* vec) {
+size_t vector_capacity_elms(vector_t* vec) {
 	return vec ? vec->capacity : 0;
 }
 
@@ -3,6 +3,10 @@
 
 #include <stdio.h>
 
+// Untyped vector; size and capacity are counted in elements of elm_width bytes and positions start at 0.
+// The functions that used to take byte counts or 1-based positions were renamed (_elms, _cnt, _at), so that
+// callers written against the old meaning fail to compile instead of corrupting memory.
+// New code should prefer the vector<T> template from typed_vector.h.
 typedef struct {
 	void* data;
 	size_t size;
@@ -25,10 +29,10 @@ void vector_dtor(vector_t* vector);
 
 //============================================================================================
 
-bool vector_has_space(vector_t* vec, size_t len);
-vec_err_t memory_add_to_fit(vector_t* vec, size_t len);
-vec_err_t memory_add(vector_t* vec, size_t new_capacity);
-vec_err_t vector_reserve(vector_t* vector, size_t new_capacity) ;
+bool vector_has_space_elms(vector_t* vec, size_t len);
+vec_err_t memory_add_to_fit_elms(vector_t* vec, size_t len);
+vec_err_t memory_add_elms(vector_t* vec, size_t new_capacity);
+vec_err_t vector_reserve_elms(vector_t* vector, size_t new_capacity) ;
 vec_err_t vector_shrink_to_fit(vector_t* vector);
 
 //============================================================================================
@@ -37,16 +41,16 @@ vec_err_t vector_pop_back(vector_t* vec, void* dst);
 
 void vector_at(vector_t* vector, void* dst, size_t index);
 
-void vector_insert(vector_t* vec, size_t pos, void* elm);
-void vector_erase_elm(vector_t* vec, size_t pos);
-void vector_erase_range(vector_t* vec, size_t first, size_t last);
+void vector_insert_at(vector_t* vec, size_t pos, void* elm);
+void vector_erase_at(vector_t* vec, size_t pos);
+void vector_erase_elms(vector_t* vec, size_t first, size_t last);   // [first, last)
 void vector_clear(vector_t* vector);
 
 void* vector_element_ptr(vector_t* vec, size_t n);
-size_t vector_size(vector_t* vec);
+size_t vector_elms_cnt(vector_t* vec);
 void* vector_head_ptr(vector_t* vec);
 void* vector_tail_ptr(vector_t* vec);
 ssize_t vector_is_empty(vector_t* vec);
-size_t vector_capacity(vector_t* vec);
+size_t vector_capacity_elms(vector_t* vec);
 
 #endif /* VECTOR_H */